@@ -7,285 +7,4492 @@
 *   Edge
 *       Represents the edge in the graph along with its source and destination nodes and it's cost/weight
 *       Weights are stored in undirected manner
+*       Templated over the node id and weight types, so ids and weights take only the bytes they need
+*           main picks the instantiation from --weights, sums of weights are kept in Cost<Weight>
+*   EdgeList
+*       Structure-of-arrays edge store, sources, destinations and weights are kept in separate arrays
+*       Sorted in place by applying a weight order permutation once, so scans are sequential
+*       Weight order is computed by an LSD radix sort, small lists fall back to comparison sort
+*       Comparison sort runs as a parallel merge sort when worker threads are given
+*   MappedFile
+*       Read-only memory mapping of an input file
+*       Lets the parser decode integers directly from the file bytes without iostreams
+*       Large inputs are split into newline-aligned chunks which are decoded by worker threads
+*   TextWriter
+*       Buffered text output, numbers are formatted with to_chars and written in 1 MiB blocks instead of flushing every line
+*   BinaryGraphHeader
+*       Versioned header of the binary edge-list format
+*       Followed by packed source, destination and weight arrays, each padded to 8 bytes
+*       Binary files are recognized by their magic and loaded without per-edge parsing
 *   PathFinder
 *       Intermediate structure for traversing all the nodes in the graph
 *       Sorts all the edges with respect to their costs/weights and then
 *       Searches all the edges in order to find all the optimum edges
 *           for ensuring all the nodes in the graph is traversed
-*       Once an edge is inserted, tries to combine different edges for augmenting graph traversal
-*           For example, if edge (a,b) is inserted and (b,y) is already in the traversed list,
-*               augment traversed list with the node (a,y)
+*       Edges can also be heapified instead of sorted, then they are popped lazily while traversing
+*           so that only the edges examined before the tree is complete pay for ordering
+*       Once an edge is inserted, merges the components of its source and destination nodes
+*           An edge whose nodes are already in the same component would create a cycle
+*   EdgeIndex
+*       Open addressing hash set of edge ids keyed by the unordered endpoint pair, and the weight unless parallel edges are merged
+*       Lets PathFinder reject repeated and reversed edges in O(1) while loading instead of scanning every edge
+*   MstStats
+*       Opt-in timings of the parse, sort, scan and output phases, edge and union-find counters and peak edge memory
+*       Every statement collecting them is removed by -DMST_NO_STATS
+*   DisjointSet
+*       Keeps track of the connected components of traversed nodes
+*       Uses path compression and union by size so that each query is nearly constant time
+*   NumaPlacement
+*       Opt-in placement for multi-socket machines, nodes and their CPUs are read from /sys/devices/system/node
+*       Workers are pinned node by node, take their own block of tasks first and only then help the others
+*       Arrays filled by workers drop their pages beforehand, so every page is first touched on the node that uses it
+*   ConcurrentDisjointSet
+*       Lock-free counterpart of DisjointSet over an atomic parent array, shared by the parallel engines
+*       Unions link roots with compare-and-swap, finds halve paths while they walk to the root
+*   EdgeSpan, MstResult, compute_mst
+*       Library interface, compute_mst builds the tree of an edge list it only views, without any file or global state
+*       With several workers, blocks of sorted edges are filtered in parallel against the union-find of the previous blocks
+*           once most edges close cycles, so only the survivors go through the sequential unions
+*       The result is refilled in place, so repeated calls reuse its storage instead of allocating per edge
+*   MstBatch
+*       Builds the trees of many small graphs on a pool of workers, each worker reusing its own sort and union-find buffers
+*       Trees of a batch are written next to each other into a single edge array
 *   SpanningTree
 *       Actual structure for constructing spanning trees
 *       Calculates cost of the spanning tree
 *           once an edge is inserted
+*       For a disconnected graph the edges form a minimum spanning forest, which is reported tree by tree
+*       Can also be written in the binary edge-list format, which loads back as a graph
+*       --cache-dir keeps such files named by a hash of the input bytes, the settings and MST_ENGINE_VERSION
+*           so a repeated run on the same input loads its tree instead of building it
+*   FilterKruskal
+*       Kruskal variant which does not sort the whole edge list
+*       Partitions edges around a pivot weight like quicksort and builds the tree from the light part first
+*       Heavy edges whose nodes are already connected are filtered out before they are ever sorted
+*   IndexedHeap
+*       4-ary min-heap of node ids keyed by weight, keeps the heap position of every node for decrease-key
+*   Prim
+*       Grows the tree from a node by always taking the lightest edge leaving the tree
+*       Edges are stored in a compressed sparse row adjacency so that neighbours are scanned sequentially
+*       Suits dense graphs better than Kruskal, choose_engine picks one of them by the density E/V
+*       Graphs joining a quarter of all node pairs or more drop the heap for an O(V^2) search of a packed key array
+*   compute_dense_mst, DenseMatrix
+*       O(V^2) Prim for complete graphs given by a weight callback, no edge is ever stored
+*       DenseMatrix indexes the rows of a mapped text matrix and decodes a row only when its node joins the tree
+*   min_key_position
+*       Minimum search over a key array with AVX2 and AVX-512 kernels, picked once at run time from the CPU features
+*       Falls back to a scalar loop on other CPUs and weight types, or everywhere with -DMST_NO_SIMD
+*   Boruvka
+*       Multicore engine, in every round each component takes its lightest outgoing edge
+*       Worker threads scan slices of the edge list and publish minimum edges with atomic compare-and-swap
+*       Edges inside a single component are dropped between rounds, so every round scans fewer edges
+*       Components are contracted in parallel through a ConcurrentDisjointSet
+*   EuclideanBoruvka
+*       Euclidean tree of a point set read by load_points, the O(n^2) point pairs are never materialised
+*       Boruvka rounds over a k-d tree, each point searches the nearest point of another component
+*           skipping subtrees inside its own component and boxes farther than the best edge of its component
+*   ExternalKruskal
+*       Kruskal for edge sets larger than memory, only the union-find is kept for all the nodes
+*       Edges are streamed from the input in blocks, sorted in runs that fit the memory budget and written to disk
+*       Runs are then merged k-way and the merged stream is fed straight into the union-find
+*   DynamicSpanningTree
+*       Keeps a minimum spanning forest up to date while new edges keep arriving
+*       Stores the forest in a link-cut tree where every tree edge is a node between its two endpoints
+*       A new edge closing a cycle replaces the heaviest edge on that cycle if it is lighter, O(log V) amortized
 */
-
 #include <vector>
-#include <set>
 #include <iostream>
 #include <algorithm>
 #include <fstream>
+#include <string>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <queue>
+#include <cstdlib>
+#include <chrono>
+#include <tuple>
+#include <cmath>
+#include <numeric>
+#include <cctype>
+#include <cerrno>
+#include <pthread.h>
+#include <sched.h>
 using namespace std;
 
+// Compile-time logging level, e.g. g++ -DMST_LOG_LEVEL=2
+//   0 : results only, 1 : summary messages (default), 2 : trace of every processed edge
+// Disabled levels are removed by the preprocessor, so the hot path pays nothing for them
+#ifndef MST_LOG_LEVEL
+#define MST_LOG_LEVEL 1
+#endif
+
+#if MST_LOG_LEVEL >= 1
+#define LOG_SUMMARY(message) (cout << message << '\n')
+#else
+#define LOG_SUMMARY(message) ((void)0)
+#endif
+
+#if MST_LOG_LEVEL >= 2
+#define LOG_TRACE(message) (cout << message << '\n')
+#else
+#define LOG_TRACE(message) ((void)0)
+#endif
+
+// Statistics are collected unless compiled with -DMST_NO_STATS, which removes every STATS statement
+#ifdef MST_NO_STATS
+#define STATS(...)
+#else
+#define STATS(...) __VA_ARGS__
+#endif
+
+// Minimum searches run AVX2 or AVX-512 kernels picked at run time on x86, -DMST_NO_SIMD keeps only the scalar loops
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && !defined(MST_NO_SIMD)
+#define MST_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
 const string INPUT_FILE = "mst_data.in";
 
+double milliseconds_since(const chrono::steady_clock::time_point start) {
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+// Work done by a DisjointSet, path_steps counts the parent links followed while locating roots
+struct UnionFindCounters{
+    uint64_t finds = 0, unions = 0, path_steps = 0;
+};
+
+// Opt-in statistics of a run, filled in by PathFinder, compute_mst and main when a pointer to them is given
+// Counters of engines which do not report them stay 0
+struct MstStats{
+    double parse_ms = 0, sort_ms = 0, scan_ms = 0, output_ms = 0;
+    uint64_t edges_examined = 0, edges_rejected = 0; // edges rejected because they would close a cycle
+    uint64_t edges_filtered = 0; // rejected ones among them which were already dropped by the parallel block filter
+    UnionFindCounters union_find;
+    size_t peak_edge_bytes = 0; // largest amount of memory held by edge arrays and their sort buffers at once
+    void add(const UnionFindCounters& counters);
+    void note_edge_bytes(const size_t bytes) {this->peak_edge_bytes = max(this->peak_edge_bytes, bytes);}
+    void print_json(ostream& output) const;
+};
+
+void MstStats::add(const UnionFindCounters& counters) {
+    this->union_find.finds += counters.finds;
+    this->union_find.unions += counters.unions;
+    this->union_find.path_steps += counters.path_steps;
+}
+
+void MstStats::print_json(ostream& output) const {
+    const double average_path_length = this->union_find.finds ? double(this->union_find.path_steps) / this->union_find.finds : 0.0;
+    output << "{\"parse_ms\": " << this->parse_ms << ", \"sort_ms\": " << this->sort_ms
+        << ", \"scan_ms\": " << this->scan_ms << ", \"output_ms\": " << this->output_ms
+        << ", \"edges_examined\": " << this->edges_examined << ", \"edges_rejected\": " << this->edges_rejected
+        << ", \"edges_filtered\": " << this->edges_filtered
+        << ", \"finds\": " << this->union_find.finds << ", \"unions\": " << this->union_find.unions
+        << ", \"average_path_length\": " << average_path_length
+        << ", \"peak_edge_bytes\": " << this->peak_edge_bytes << "}" << endl;
+}
+
+// Sum of weights, wide enough not to overflow for large trees
+template <typename Weight>
+using Cost = typename conditional<is_floating_point<Weight>::value, double, int64_t>::type;
+
+template <typename NodeId, typename Weight>
 class Edge{
     public:
-        Edge(const int s=-1, const int d=-1, const int w=-1) : source(s), destination(d), weight(w) {} // INITIALIZER LIST SYNTAX
-        int get_source() {return this->source ;}
-        int get_destination() {return this->destination ;}
-        int get_weight() {return this->weight ;}
+        Edge(const NodeId s=NodeId(-1), const NodeId d=NodeId(-1), const Weight w=Weight(-1)) : source(s), destination(d), weight(w) {} // INITIALIZER LIST SYNTAX
+        NodeId get_source() const {return this->source ;}
+        NodeId get_destination() const {return this->destination ;}
+        Weight get_weight() const {return this->weight ;}
         bool operator==(const Edge e);
     private:
-        int weight, source,destination;
+        NodeId source,destination;
+        Weight weight;
 };
 
-bool Edge::operator==(const Edge e) {
+static_assert(sizeof(Edge<uint32_t, float>) == 12, "32-bit ids with 32-bit weights take 12 bytes per edge");
+
+template <typename NodeId, typename Weight>
+bool Edge<NodeId, Weight>::operator==(const Edge e) {
     return ( (this->source == e.source) && (this->destination == e.destination) && (this->weight == e.weight) ) ;
 }
 
-class PathFinder{
+template <typename NodeId>
+class DisjointSet{
     public:
-        PathFinder() : index(0),num_of_traversed_edges(0) {} //INITIALIZER LIST SYNTAX
-        Edge* traverse() ;
-        void parse_input(const string input_file);
-        void insert_new_edge(const int s, const int d, const int w);
-        void sort_edges(){sort(this->all_weights.begin(),this->all_weights.end());} // Performs Quick Sort
-        void print() ;
-        int get_node_size() {return this->num_of_nodes;}
-        bool are_nodes_traversed(const int source, const int destination);
-        bool is_edge_traversed(const int source, const int destination);
-        bool check_cycle(const int source, const int destination);
-        void augment_components(const int source, const int destination);
+        DisjointSet(const size_t n=0) {this->reset(n);}
+        void reset(const size_t n);
+        NodeId find(NodeId node);
+        NodeId find_root(NodeId node) const; // without path compression, safe from many threads while nobody unites
+        bool unite(const NodeId a, const NodeId b);
+        bool is_connected(const NodeId a, const NodeId b) {return this->find(a) == this->find(b);}
+        const UnionFindCounters& get_counters() {return this->counters;}
     private:
-        vector<pair<int,int>> all_weights;
-        vector<Edge> all_edges;
-        set<pair<int,int>> traversed_edges;
-        int index, num_of_nodes, num_of_traversed_edges;
-        set<int> traversed_nodes;
+        vector<NodeId> parent, component_size;
+        UnionFindCounters counters; // since the last reset
+};
+
+template <typename NodeId>
+void DisjointSet<NodeId>::reset(const size_t n) {
+    // Every node starts as a component of its own
+    this->parent.resize(n);
+    this->component_size.assign(n, 1);
+    for (size_t idx = 0; idx < n; ++idx) {
+        this->parent[idx] = NodeId(idx);
+    }
+    this->counters = UnionFindCounters();
+}
+
+template <typename NodeId>
+NodeId DisjointSet<NodeId>::find(NodeId node) {
+    // Locate the root, then point every node on the way directly to it
+    NodeId root = node;
+    STATS(this->counters.finds ++;)
+    while (this->parent[root] != root) {
+        root = this->parent[root];
+        STATS(this->counters.path_steps ++;)
+    }
+    while (this->parent[node] != root) {
+        NodeId next = this->parent[node];
+        this->parent[node] = root;
+        node = next;
+    }
+    return root;
+}
+
+template <typename NodeId>
+NodeId DisjointSet<NodeId>::find_root(NodeId node) const {
+    while (this->parent[node] != node) {
+        node = this->parent[node];
+    }
+    return node;
+}
+
+template <typename NodeId>
+bool DisjointSet<NodeId>::unite(const NodeId a, const NodeId b) {
+    NodeId root_a = this->find(a), root_b = this->find(b);
+    if (root_a == root_b) {
+        return false;
+    }
+
+    // Hang the smaller component below the larger one for keeping trees shallow
+    if (this->component_size[root_a] < this->component_size[root_b]) {
+        swap(root_a, root_b);
+    }
+    this->parent[root_b] = root_a;
+    this->component_size[root_a] += this->component_size[root_b];
+    STATS(this->counters.unions ++;)
+    return true;
+}
+
+// NUMA placement requested by --numa, everything below is a no-op while it is disabled
+//   workers are pinned to CPUs node by node, so worker w of W runs on node w * nodes / W
+//   run_tasks gives every worker a contiguous block of tasks before it steals from the others
+//   arrays filled by run_tasks have their pages dropped first, so each page lands on the node of the worker writing it
+struct NumaPlacement{
+    bool is_enabled = false;
+    vector<vector<unsigned>> node_cpus; // CPUs of every node this process may run on
 };
 
-bool PathFinder::are_nodes_traversed(const int source, const int destination) {
-    bool is_source_found = false, is_destination_found = false;
-    for (auto &traversed_node : this->traversed_edges ) {
-        if (traversed_node.first == source ) {
-            is_source_found = true;
+NumaPlacement& numa_placement() {
+    static NumaPlacement placement;
+    return placement;
+}
+
+void pin_worker(const unsigned worker, const unsigned workers) {
+    const vector<vector<unsigned>> &node_cpus = numa_placement().node_cpus;
+    const size_t node = size_t(worker) * node_cpus.size() / workers;
+    const size_t first_worker = (node * workers + node_cpus.size() - 1) / node_cpus.size(); // first worker of this node
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(node_cpus[node][(worker - first_worker) % node_cpus[node].size()], &cpus);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+}
+
+// Gives the whole pages of a freshly allocated array back to the kernel, the next write to a page decides its node
+// Only for memory that is about to be overwritten completely, it reads back as zeros
+void drop_pages(void* data, const size_t bytes) {
+    if (!numa_placement().is_enabled || bytes == 0) {
+        return;
+    }
+    const uintptr_t page = uintptr_t(sysconf(_SC_PAGESIZE));
+    const uintptr_t first = (uintptr_t(data) + page - 1) & ~(page - 1);
+    const uintptr_t last = (uintptr_t(data) + bytes) & ~(page - 1);
+    if (first < last) {
+        madvise(reinterpret_cast<void*>(first), last - first, MADV_DONTNEED);
+    }
+}
+
+// run_tasks under NUMA placement, worker w owns tasks [w * T / W, (w + 1) * T / W) and runs them in order,
+// then helps the other workers from their unfinished blocks onwards
+template <typename Task>
+void run_local_tasks(const unsigned num_of_threads, const size_t num_of_tasks, Task& task) {
+    vector<atomic<size_t>> next_tasks(num_of_threads);
+    vector<size_t> block_ends(num_of_threads);
+    for (unsigned worker = 0; worker < num_of_threads; ++worker) {
+        next_tasks[worker].store(num_of_tasks * worker / num_of_threads);
+        block_ends[worker] = num_of_tasks * (worker + 1) / num_of_threads;
+    }
+    auto worker_loop = [&](const unsigned worker) {
+        for (unsigned step = 0; step < num_of_threads; ++step) {
+            const unsigned owner = (worker + step) % num_of_threads;
+            for (size_t current = next_tasks[owner]++; current < block_ends[owner]; current = next_tasks[owner]++) {
+                task(current);
+            }
+        }
+    };
+
+    // The calling thread works as worker 0 and gets its own affinity back afterwards
+    cpu_set_t caller_cpus;
+    pthread_getaffinity_np(pthread_self(), sizeof(caller_cpus), &caller_cpus);
+    vector<thread> threads;
+    for (unsigned worker = 1; worker < num_of_threads; ++worker) {
+        threads.push_back(thread([&, worker]() {
+            pin_worker(worker, num_of_threads);
+            worker_loop(worker);
+        }));
+    }
+    pin_worker(0, num_of_threads);
+    worker_loop(0);
+    for (auto &worker_thread : threads) {
+        worker_thread.join();
+    }
+    pthread_setaffinity_np(pthread_self(), sizeof(caller_cpus), &caller_cpus);
+}
+
+// Runs task(0), ..., task(num_of_tasks - 1) on the given number of threads
+// Tasks are handed out one by one, so a thread finishing early picks up the remaining work
+template <typename Task>
+void run_tasks(const unsigned workers, const size_t num_of_tasks, Task task) {
+    if (numa_placement().is_enabled && min<size_t>(workers, num_of_tasks) > 1) {
+        run_local_tasks(unsigned(min<size_t>(workers, num_of_tasks)), num_of_tasks, task);
+        return;
+    }
+    atomic<size_t> next_task(0);
+    auto worker_loop = [&]() {
+        for (size_t current = next_task++; current < num_of_tasks; current = next_task++) {
+            task(current);
         }
+    };
+
+    const unsigned num_of_threads = unsigned(min<size_t>(max(1u, workers), num_of_tasks));
+    vector<thread> threads;
+    for (unsigned worker = 1; worker < num_of_threads; ++worker) {
+        threads.push_back(thread(worker_loop));
+    }
+    worker_loop();
+    for (auto &worker_thread : threads) {
+        worker_thread.join();
+    }
+}
+
+// Ranges shorter than this are sorted by a single thread
+const size_t PARALLEL_SORT_MIN_ITEMS = 1 << 16;
 
-        if (traversed_node.second == destination) {
-            is_destination_found = true;
+// Number of items taken from a when the first k items of the stable merge of a and b are produced
+template <typename T, typename Compare>
+size_t merge_co_rank(const size_t k, const T* a, const size_t na, const T* b, const size_t nb, Compare less) {
+    size_t low = (k > nb) ? k - nb : 0, high = min(k, na);
+    while (low < high) {
+        const size_t i = (low + high) / 2;
+        if (less(b[k - i - 1], a[i])) {
+            high = i;
+        } else {
+            low = i + 1;
         }
     }
-    return (is_source_found and is_destination_found);
+    return low;
 }
 
-bool PathFinder::is_edge_traversed(const int source, const int destination) {
-    bool is_edge_traversed = false;
-    if (find(this->traversed_edges.begin(),this->traversed_edges.end(),make_pair(source,destination)) != this->traversed_edges.end()) {
-        is_edge_traversed = true;
+// Stable parallel merge sort
+// Every worker sorts one slice, then slices are merged pairwise, each merge split into pieces of equal output size
+template <typename T, typename Compare>
+void parallel_sort(vector<T>& data, const unsigned workers, Compare less) {
+    const size_t n = data.size();
+    if (workers <= 1 || n < PARALLEL_SORT_MIN_ITEMS) {
+        stable_sort(data.begin(), data.end(), less);
+        return;
+    }
+
+    vector<size_t> bounds(workers + 1);
+    for (unsigned slice = 0; slice <= workers; ++slice) {
+        bounds[slice] = n * slice / workers;
+    }
+    run_tasks(workers, workers, [&](const size_t slice) {
+        stable_sort(data.begin() + bounds[slice], data.begin() + bounds[slice + 1], less);
+    });
+
+    vector<T> buffer(n);
+    for (size_t width = 1; width < workers; width *= 2) {
+        const size_t num_of_merges = (workers + 2 * width - 1) / (2 * width);
+        run_tasks(workers, num_of_merges * workers, [&](const size_t task) {
+            const size_t left = (task / workers) * 2 * width, piece = task % workers;
+            const size_t middle = min<size_t>(left + width, workers), right = min<size_t>(left + 2 * width, workers);
+            const T* a = data.data() + bounds[left];
+            const T* b = data.data() + bounds[middle];
+            const size_t na = bounds[middle] - bounds[left], nb = bounds[right] - bounds[middle];
+            const size_t first = (na + nb) * piece / workers, last = (na + nb) * (piece + 1) / workers;
+            const size_t a_first = merge_co_rank(first, a, na, b, nb, less), a_last = merge_co_rank(last, a, na, b, nb, less);
+            merge(a + a_first, a + a_last, b + (first - a_first), b + (last - a_last), buffer.begin() + bounds[left] + first, less);
+        });
+        data.swap(buffer);
     }
+}
+
+const int SORT_AUTO = 0; // radix sort for large lists of integral weights, comparison sort otherwise
+const int SORT_RADIX = 1; // ignored for floating point weights
+const int SORT_COMPARISON = 2;
+
+template <typename NodeId, typename Weight>
+struct EdgeList{
+    vector<NodeId> sources, destinations;
+    vector<Weight> weights;
 
-    return is_edge_traversed;
+    size_t size() const {return this->weights.size();}
+    void reserve(const size_t n);
+    void push_back(const NodeId s, const NodeId d, const Weight w);
+    void clear();
+    void swap_edges(const size_t a, const size_t b);
+    void sort_by_weight(const int method=SORT_AUTO, const unsigned workers=1);
+    void place_on_nodes(const unsigned workers); // spreads the columns over the NUMA nodes of the workers, see copy_column
+};
+
+const size_t EDGE_NOT_FOUND = size_t(-1);
+
+template <typename NodeId, typename Weight>
+void EdgeList<NodeId, Weight>::reserve(const size_t n) {
+    this->sources.reserve(n);
+    this->destinations.reserve(n);
+    this->weights.reserve(n);
 }
 
-void PathFinder::parse_input(const string input_file){
-    ifstream input(input_file);
-    // Read first line indicating node size of graph
-    int nodes;
-    if (input >> nodes) {
-        this -> num_of_nodes = nodes;
+template <typename NodeId, typename Weight>
+void EdgeList<NodeId, Weight>::push_back(const NodeId s, const NodeId d, const Weight w) {
+    this->sources.push_back(s);
+    this->destinations.push_back(d);
+    this->weights.push_back(w);
+}
+
+template <typename NodeId, typename Weight>
+void EdgeList<NodeId, Weight>::clear() {
+    vector<NodeId>().swap(this->sources);
+    vector<NodeId>().swap(this->destinations);
+    vector<Weight>().swap(this->weights);
+}
+
+template <typename NodeId, typename Weight>
+void EdgeList<NodeId, Weight>::swap_edges(const size_t a, const size_t b) {
+    swap(this->sources[a], this->sources[b]);
+    swap(this->destinations[a], this->destinations[b]);
+    swap(this->weights[a], this->weights[b]);
+}
+
+// Lists shorter than this are sorted by comparison, radix passes would not pay off
+const size_t RADIX_SORT_MIN_EDGES = 1 << 8;
+
+// Gathers every array through the permutation, one array at a time for keeping the extra memory at one column
+// Large columns are gathered by slices on the given workers, each slice ends up on the node of the worker writing it
+template <typename T>
+void apply_permutation(vector<T>& column, const vector<uint32_t>& order, const unsigned workers=1) {
+    vector<T> permuted(column.size());
+    drop_pages(permuted.data(), permuted.size() * sizeof(T));
+    const unsigned num_of_slices = (order.size() >= PARALLEL_SORT_MIN_ITEMS) ? max(1u, workers) : 1;
+    run_tasks(num_of_slices, num_of_slices, [&](const size_t slice) {
+        const size_t first = order.size() * slice / num_of_slices, last = order.size() * (slice + 1) / num_of_slices;
+        for (size_t idx = first; idx < last; ++idx) {
+            permuted[idx] = column[order[idx]];
+        }
+    });
+    column.swap(permuted);
+}
+
+// Copies a column slice by slice on the given workers, under NUMA placement every slice is first touched by its worker
+template <typename T>
+void copy_column(const vector<T>& from, vector<T>& to, const unsigned workers) {
+    if (!numa_placement().is_enabled || workers < 2) {
+        to = from;
+        return;
     }
+    vector<T> placed(from.size());
+    drop_pages(placed.data(), placed.size() * sizeof(T));
+    run_tasks(workers, workers, [&](const size_t slice) {
+        const size_t first = from.size() * slice / workers, last = from.size() * (slice + 1) / workers;
+        copy(from.begin() + first, from.begin() + last, placed.begin() + first);
+    });
+    to.swap(placed);
+}
 
-    // Read source node, destination node and weight of the edge between these nodes
-    int source,destination,weight;
-    while(input >> source >> destination >> weight) {
-        this->insert_new_edge(source,destination,weight);
+// Maps an integral weight to an unsigned key of the same width which sorts in the same order
+template <typename Weight>
+typename make_unsigned<Weight>::type radix_key(const Weight weight) {
+    typedef typename make_unsigned<Weight>::type Key;
+    Key key = Key(weight);
+    if (is_signed<Weight>::value) {
+        key ^= Key(1) << (8 * sizeof(Key) - 1); // flipped sign bit puts negative weights first
     }
+    return key;
 }
 
-void PathFinder::insert_new_edge(const int s, const int d, const int w) {
-    // Stores tuple of i,j,weight corresponding edge
+// Key and id of an edge while it is radix sorted, only a placeholder for floating point weights
+template <typename Weight, bool = is_integral<Weight>::value>
+struct RadixItem{
+    typename make_unsigned<Weight>::type key;
+    uint32_t id;
+};
+
+template <typename Weight>
+struct RadixItem<Weight, false>{
+    uint32_t key, id;
+};
+
+// Scratch arrays of sort_order_by_weight, kept by callers which sort many small edge lists
+template <typename Weight>
+struct SortBuffers{
+    vector<RadixItem<Weight>> items, buffer;
+    vector<size_t> histogram;
+    vector<pair<Weight,uint32_t>> keys;
+};
 
-    // insert if a new edge comes
-    // if (x,y,w) already exist, do not add (y,x,w) again
-    if ( find(this->all_edges.begin(),this->all_edges.end(),Edge(d,s,w)) != this->all_edges.end() ){
-        cout<< "Can not insert edge (" << s << "," << d << "). Since there exist another edge (" 
-        <<   d << "," << s << ") in the graph" << endl; 
+// Stable LSD radix sort of edge ids by integral weights, one byte of the key per pass
+// Passes in which every key has the same byte are skipped, so bounded weights need fewer passes
+template <typename Weight>
+void radix_sort_by_weight(const Weight* weights, const size_t n, vector<uint32_t>& order, SortBuffers<Weight>& buffers) {
+    if (n == 0) {
+        order.clear(); // every pass below reads the key of the first item
         return;
     }
-    
-    // Add this new-coming edge
-    this->all_edges.push_back(Edge(s,d,w));
+    typedef typename make_unsigned<Weight>::type Key;
+    const int num_of_passes = sizeof(Key);
+    vector<RadixItem<Weight>> &items = buffers.items, &buffer = buffers.buffer;
+    items.resize(n);
+    buffer.resize(n);
+    vector<size_t> &histogram = buffers.histogram;
+    histogram.assign(num_of_passes * 256, 0);
+    for (size_t idx = 0; idx < n; ++idx) {
+        const Key key = radix_key(weights[idx]);
+        items[idx].key = key;
+        items[idx].id = uint32_t(idx);
+        for (int pass = 0; pass < num_of_passes; ++pass) {
+            histogram[pass * 256 + ((key >> (8 * pass)) & 0xff)] ++;
+        }
+    }
 
-    // Store weight of the edge along with its index for sorting in convenient way
-    this->all_weights.push_back(make_pair(w,this->index));
-    
-    // Increment id of the edge
-    this->index ++;
+    for (int pass = 0; pass < num_of_passes; ++pass) {
+        size_t* buckets = histogram.data() + pass * 256;
+        const int shift = 8 * pass;
+        if (buckets[(items[0].key >> shift) & 0xff] == n) {
+            continue;
+        }
+        // Turn counts into starting offsets of every bucket
+        size_t offset = 0;
+        for (int bucket = 0; bucket < 256; ++bucket) {
+            const size_t count = buckets[bucket];
+            buckets[bucket] = offset;
+            offset += count;
+        }
+        for (size_t idx = 0; idx < n; ++idx) {
+            buffer[buckets[(items[idx].key >> shift) & 0xff]++] = items[idx];
+        }
+        items.swap(buffer);
+    }
+
+    order.resize(n);
+    for (size_t idx = 0; idx < n; ++idx) {
+        order[idx] = items[idx].id;
+    }
 }
 
-void PathFinder::print() {
-    for (auto &item : this->all_weights) {
-        //cout << "Index : " << item.second <<", Weight: " << item.first<< endl;
-        cout << "Edge[" << item.second <<"] => Source : " << this->all_edges[item.second].get_source() 
-            << ", Destination: " << this->all_edges[item.second].get_destination() 
-            << ", Weight: " << this->all_edges[item.second].get_weight()
-            << endl;
+// Computes the ids of n edges in the order of their weights, ties are kept in id order by both sorts
+template <typename Weight>
+void sort_order_by_weight(const Weight* weights, const size_t n, const int method, const unsigned workers, vector<uint32_t>& order, SortBuffers<Weight>& buffers) {
+    if constexpr (is_integral<Weight>::value) {
+        if (method == SORT_RADIX || (method == SORT_AUTO && n >= RADIX_SORT_MIN_EDGES)) {
+            radix_sort_by_weight(weights, n, order, buffers);
+            return;
+        }
+    }
+    vector<pair<Weight,uint32_t>> &keys = buffers.keys;
+    keys.resize(n);
+    for (size_t idx = 0; idx < n; ++idx) {
+        keys[idx] = make_pair(weights[idx], uint32_t(idx));
+    }
+    if (workers <= 1) {
+        sort(keys.begin(), keys.end()); // (weight, id) pairs are distinct, so this gives the stable order without a merge buffer
+    } else {
+        parallel_sort(keys, workers, [](const pair<Weight,uint32_t>& a, const pair<Weight,uint32_t>& b) {return a.first < b.first;});
+    }
+    order.resize(n);
+    for (size_t idx = 0; idx < n; ++idx) {
+        order[idx] = keys[idx].second;
+    }
+}
+
+template <typename Weight>
+void sort_order_by_weight(const Weight* weights, const size_t n, const int method, const unsigned workers, vector<uint32_t>& order) {
+    SortBuffers<Weight> buffers;
+    sort_order_by_weight(weights, n, method, workers, order, buffers);
+}
+
+template <typename NodeId, typename Weight>
+void EdgeList<NodeId, Weight>::sort_by_weight(const int method, const unsigned workers) {
+    vector<uint32_t> order;
+    sort_order_by_weight(this->weights.data(), this->size(), method, workers, order);
+
+    apply_permutation(this->sources, order, workers);
+    apply_permutation(this->destinations, order, workers);
+    apply_permutation(this->weights, order, workers);
+}
+
+template <typename NodeId, typename Weight>
+void EdgeList<NodeId, Weight>::place_on_nodes(const unsigned workers) {
+    copy_column(this->sources, this->sources, workers);
+    copy_column(this->destinations, this->destinations, workers);
+    copy_column(this->weights, this->weights, workers);
+}
+
+const int DEDUP_EXACT = 0; // drops an edge repeating both endpoints and the weight of an earlier one, in either direction
+const int DEDUP_MIN_WEIGHT = 1; // keeps a single edge between two nodes, with the smallest weight seen
+const int DEDUP_NONE = 2;
+
+const uint32_t EMPTY_SLOT = ~uint32_t(0);
+
+// Open addressing hash set of edge ids, two ids are equal when their edges join the same pair of nodes
+// and, unless only the endpoints are compared, have the same weight
+// Edges themselves stay in the EdgeList, a slot only holds an id
+template <typename NodeId, typename Weight>
+class EdgeIndex{
+    public:
+        EdgeIndex(const bool compare_weights=true) : is_weight_compared(compare_weights), num_of_ids(0) {}
+        void reset(const bool compare_weights, const size_t expected_edges);
+        size_t find_or_insert(const EdgeList<NodeId, Weight>& edges, const size_t id); // EDGE_NOT_FOUND if id was inserted
+        size_t get_bytes() {return this->slots.capacity() * sizeof(uint32_t);}
+    private:
+        uint64_t hash(const EdgeList<NodeId, Weight>& edges, const size_t id) const;
+        bool is_same(const EdgeList<NodeId, Weight>& edges, const size_t a, const size_t b) const;
+        void grow(const EdgeList<NodeId, Weight>& edges);
+        bool is_weight_compared;
+        size_t num_of_ids;
+        vector<uint32_t> slots; // EMPTY_SLOT or an edge id, size is a power of two
+};
+
+// Finalizer of splitmix64, spreads consecutive node ids over the whole table
+uint64_t mix_hash(uint64_t value) {
+    value ^= value >> 30;
+    value *= 0xbf58476d1ce4e5b9ull;
+    value ^= value >> 27;
+    value *= 0x94d049bb133111ebull;
+    return value ^ (value >> 31);
+}
+
+// Non-cryptographic hash of a byte range, four independent multiply lanes over 8-byte words keep up with memory bandwidth
+uint64_t hash_bytes(const char* data, const size_t length, const uint64_t seed) {
+    uint64_t lanes[4] = {seed, seed ^ 0x9e3779b97f4a7c15ull, seed ^ 0xbf58476d1ce4e5b9ull, seed ^ 0x94d049bb133111ebull};
+    size_t idx = 0;
+    for (; idx + sizeof(lanes) <= length; idx += sizeof(lanes)) {
+        for (int lane = 0; lane < 4; ++lane) {
+            uint64_t word;
+            memcpy(&word, data + idx + lane * sizeof(word), sizeof(word));
+            lanes[lane] = (lanes[lane] ^ word) * 0xff51afd7ed558ccdull;
+            lanes[lane] ^= lanes[lane] >> 32;
+        }
+    }
+    uint64_t hash = mix_hash(seed ^ length);
+    for (const uint64_t lane : lanes) {
+        hash = mix_hash(hash ^ lane);
     }
+    for (; idx < length; ++idx) {
+        hash = (hash ^ uint8_t(data[idx])) * 0x100000001b3ull;
+    }
+    return mix_hash(hash);
+}
+
+template <typename NodeId, typename Weight>
+void EdgeIndex<NodeId, Weight>::reset(const bool compare_weights, const size_t expected_edges) {
+    // Load factor is kept at most one half
+    size_t capacity = 16;
+    while (capacity < 2 * expected_edges) {
+        capacity *= 2;
+    }
+    this->is_weight_compared = compare_weights;
+    this->num_of_ids = 0;
+    this->slots.assign(capacity, EMPTY_SLOT);
 }
 
-bool PathFinder::check_cycle(const int source, const int destination) {
-    cout << "Will check cycles for (" << source << "," << destination << ")" << endl;
-    // Let new item be (x,t)
-    // If traversed vector contains both (x,y) && (t,y), we'll see a loop here
-    bool is_found = false;
-    for (int idx = 0; idx < num_of_nodes; ++idx) {
-        if(  (is_edge_traversed(source,idx)) &&  (is_edge_traversed(destination,idx))   ) {
-            cout << "CYCLE exist regarding (" << source << "," << idx << ")" " and " <<
-                "(" << destination << "," << idx << ")" <<endl;
-            is_found = true;
-        } 
+template <typename NodeId, typename Weight>
+uint64_t EdgeIndex<NodeId, Weight>::hash(const EdgeList<NodeId, Weight>& edges, const size_t id) const {
+    // Endpoints are ordered first, so (x,y) and (y,x) hash the same
+    const uint64_t low = min(edges.sources[id], edges.destinations[id]), high = max(edges.sources[id], edges.destinations[id]);
+    uint64_t value = mix_hash(low * 0x9e3779b97f4a7c15ull + high);
+    if (this->is_weight_compared) {
+        value = mix_hash(value ^ std::hash<Weight>()(edges.weights[id]));
     }
-    
+    return value;
+}
+
+template <typename NodeId, typename Weight>
+bool EdgeIndex<NodeId, Weight>::is_same(const EdgeList<NodeId, Weight>& edges, const size_t a, const size_t b) const {
+    const bool is_same_pair = (edges.sources[a] == edges.sources[b] && edges.destinations[a] == edges.destinations[b]) ||
+        (edges.sources[a] == edges.destinations[b] && edges.destinations[a] == edges.sources[b]);
+    return is_same_pair && (!this->is_weight_compared || edges.weights[a] == edges.weights[b]);
+}
 
-    // Let new item be (y,z)
-    // If traversed vector contains both (x,y) && (x,z), we'll see a loop here
-    for (int idx = 0; idx < num_of_nodes; ++idx) {
-        if(  (is_edge_traversed(idx,source)) &&  (is_edge_traversed(idx,destination))   ) {
-            cout << "CYCLE exist regarding (" << idx << "," << source << ")" " and " <<
-                "(" << idx << "," << destination << ")" <<endl;
-            is_found = true;
-        } 
+template <typename NodeId, typename Weight>
+void EdgeIndex<NodeId, Weight>::grow(const EdgeList<NodeId, Weight>& edges) {
+    vector<uint32_t> old_slots(max<size_t>(16, 2 * this->slots.size()), EMPTY_SLOT);
+    old_slots.swap(this->slots);
+    const size_t mask = this->slots.size() - 1;
+    for (const uint32_t id : old_slots) {
+        if (id != EMPTY_SLOT) {
+            size_t slot = this->hash(edges, id) & mask;
+            while (this->slots[slot] != EMPTY_SLOT) {
+                slot = (slot + 1) & mask;
+            }
+            this->slots[slot] = id;
+        }
     }
+}
 
-    return is_found;
+template <typename NodeId, typename Weight>
+size_t EdgeIndex<NodeId, Weight>::find_or_insert(const EdgeList<NodeId, Weight>& edges, const size_t id) {
+    if (2 * (this->num_of_ids + 1) > this->slots.size()) {
+        this->grow(edges);
+    }
+    // Linear probing until the edge or an empty slot is found
+    const size_t mask = this->slots.size() - 1;
+    for (size_t slot = this->hash(edges, id) & mask; ; slot = (slot + 1) & mask) {
+        if (this->slots[slot] == EMPTY_SLOT) {
+            this->slots[slot] = uint32_t(id);
+            this->num_of_ids ++;
+            return EDGE_NOT_FOUND;
+        }
+        if (this->is_same(edges, this->slots[slot], id)) {
+            return this->slots[slot];
+        }
+    }
 }
 
-Edge* PathFinder::traverse() {
-    int source_node, destination_node;
-    bool is_source_traversed, is_destination_traversed;
-    //sorted by item.first indicating weight of the edge
-    for (auto &item : this->all_weights) {
-        source_node = this->all_edges[item.second].get_source();
-        destination_node = this->all_edges[item.second].get_destination();
+template <typename NodeId>
+class ConcurrentDisjointSet{
+    public:
+        ConcurrentDisjointSet(const size_t n=0) {this->reset(n);}
+        void reset(const size_t n, const unsigned workers=1);
+        NodeId find(NodeId node);
+        bool unite(NodeId a, NodeId b);
+        bool is_connected(NodeId a, NodeId b);
+    private:
+        vector<atomic<NodeId>> parent;
+};
 
-        cout << "Processing edge (" << source_node << "," << destination_node << ") with weight " << item.first << endl;
+template <typename NodeId>
+void ConcurrentDisjointSet<NodeId>::reset(const size_t n, const unsigned workers) {
+    // Workers initialise their own slices, so that the parents are spread like the nodes they are scanned with
+    vector<atomic<NodeId>> nodes(n);
+    drop_pages(nodes.data(), n * sizeof(atomic<NodeId>));
+    const unsigned num_of_slices = (n >= PARALLEL_SORT_MIN_ITEMS) ? max(1u, workers) : 1;
+    run_tasks(num_of_slices, num_of_slices, [&](const size_t slice) {
+        for (size_t idx = n * slice / num_of_slices; idx < n * (slice + 1) / num_of_slices; ++idx) {
+            nodes[idx].store(NodeId(idx), memory_order_relaxed);
+        }
+    });
+    this->parent.swap(nodes);
+}
 
-        // If all nodes are traversed, which means containing node-1 edges, termination conditition
-        if (this->num_of_traversed_edges == (this->num_of_nodes -1)) {
-            cout << "Spanning tree now contains " << this->num_of_traversed_edges << " edges. Terminating..." << endl;
-            return nullptr;
+template <typename NodeId>
+NodeId ConcurrentDisjointSet<NodeId>::find(NodeId node) {
+    // Path halving, every visited node is pointed to its grandparent
+    // A failed compare-and-swap only means another thread already moved the node closer to the root
+    while (true) {
+        NodeId parent = this->parent[node].load(memory_order_acquire);
+        if (parent == node) {
+            return node;
         }
+        const NodeId grandparent = this->parent[parent].load(memory_order_acquire);
+        if (grandparent != parent) {
+            this->parent[node].compare_exchange_weak(parent, grandparent, memory_order_release, memory_order_relaxed);
+        }
+        node = grandparent;
+    }
+}
 
-        
-        /*
-        // If all nodes are traversed, terminate
-        if (this->traversed_nodes.size () == (this->num_of_nodes )) {
-            cout << "Spanning tree now contains " << this->traversed_nodes.size() << " nodes. Terminating..." << endl;
-            return nullptr;
+template <typename NodeId>
+bool ConcurrentDisjointSet<NodeId>::unite(NodeId a, NodeId b) {
+    while (true) {
+        a = this->find(a);
+        b = this->find(b);
+        if (a == b) {
+            return false;
+        }
+        // Roots are always hung below the smaller id, so concurrent unions can never link a cycle
+        if (a < b) {
+            swap(a, b);
         }
-        */
-        
+        NodeId expected = a;
+        if (this->parent[a].compare_exchange_strong(expected, b, memory_order_acq_rel)) {
+            return true;
+        }
+        // a stopped being a root meanwhile, retry from the new roots
+    }
+}
 
-        // If this edge are traversed beforehand, skip this edge
-        //if( are_nodes_traversed(source_node, destination_node)) {
-        if (is_edge_traversed(source_node, destination_node)) {
-            cout << "Edge (" << source_node << "," << destination_node << ") is already traversed. Skipping..." <<endl;
-            continue;
+template <typename NodeId>
+bool ConcurrentDisjointSet<NodeId>::is_connected(NodeId a, NodeId b) {
+    while (true) {
+        a = this->find(a);
+        b = this->find(b);
+        if (a == b) {
+            return true;
         }
+        // Roots differ, the answer holds only if a was not linked while b was being found
+        if (this->parent[a].load(memory_order_acquire) == a) {
+            return false;
+        }
+    }
+}
 
-        // Do not create cycle
-        if (check_cycle(source_node, destination_node)) {
-            cout << "Edge (" << source_node << "," << destination_node << ") will create a loop. Skipping..." <<endl;
-            // Erase current item from the traversal list
-            this->all_weights.erase(remove(this->all_weights.begin(),this->all_weights.end(),item));
-            return new Edge(-1,-1,-1);
+class MappedFile{
+    public:
+        MappedFile(const string path);
+        ~MappedFile();
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        bool is_open() {return this->is_mapped;}
+        const char* begin() {return this->data;}
+        const char* end() {return this->data + this->length;}
+        size_t size() {return this->length;}
+    private:
+        const char* data;
+        size_t length;
+        bool is_mapped;
+};
+
+MappedFile::MappedFile(const string path) : data(nullptr), length(0), is_mapped(false) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode)) {
+        this->length = info.st_size;
+        if (this->length == 0) {
+            // Nothing to map, an empty file is still a valid (empty) input
+            this->is_mapped = true;
+        } else {
+            void* address = mmap(nullptr, this->length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (address != MAP_FAILED) {
+                madvise(address, this->length, MADV_SEQUENTIAL);
+                this->data = static_cast<const char*>(address);
+                this->is_mapped = true;
+            }
         }
+    }
+    // The mapping stays valid after the descriptor is closed
+    close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (this->data != nullptr) {
+        munmap(const_cast<char*>(this->data), this->length);
+    }
+}
+
+// Skips whitespace and decodes the next integer or floating point number starting from cursor
+// Returns false at the end of input or if the next token is not a number, like ifstream >> does
+template <typename T>
+bool scan_value(const char*& cursor, const char* end, T& value) {
+    while (cursor != end && (*cursor == ' ' || *cursor == '\n' || *cursor == '\t' || *cursor == '\r' || *cursor == '\v' || *cursor == '\f')) {
+        ++cursor;
+    }
+    if (cursor != end && *cursor == '+') {
+        ++cursor;
+    }
+
+    auto result = from_chars(cursor, end, value);
+    if (result.ec != errc()) {
+        return false;
+    }
+    cursor = result.ptr;
+    return true;
+}
+
+// Whether bytes of text can hold rows * columns numbers, each one a digit and a separator but the last
+// The product is never formed, so counts read from a crafted header can not overflow it
+bool is_text_large_enough(const size_t rows, const size_t columns, const size_t bytes) {
+    return rows == 0 || columns <= (bytes / 2 + bytes % 2) / rows;
+}
+
+const size_t TEXT_WRITER_BYTES = 1 << 20;
+
+// Formats numbers with to_chars into a large buffer which is handed to the stream in blocks, instead of flushing every line
+// Floating point numbers keep the 6 significant digits of the default ostream format, so the output does not change
+class TextWriter{
+    public:
+        TextWriter(ostream& stream) : output(stream), buffer(TEXT_WRITER_BYTES), used(0) {}
+        ~TextWriter() {this->flush();}
+        TextWriter(const TextWriter&) = delete;
+        TextWriter& operator=(const TextWriter&) = delete;
+        TextWriter& operator<<(const char c);
+        TextWriter& operator<<(const char* text) {return this->append(text, strlen(text));}
+        TextWriter& operator<<(const string& text) {return this->append(text.data(), text.size());}
+        template <typename T>
+        TextWriter& operator<<(const T value);
+        void flush();
+    private:
+        TextWriter& append(const char* text, const size_t length);
+        ostream& output;
+        vector<char> buffer;
+        size_t used;
+};
 
-        // Mark source and destionation nodes as traversed, mark this edge as traversed
-        this->traversed_nodes.insert(source_node);this->traversed_nodes.insert(destination_node);
-        this->traversed_edges.insert(make_pair(source_node, destination_node));
-        this->num_of_traversed_edges ++ ; // do not increase this counter while augmenting
-        
+// Longest number to_chars writes, a 64-bit integer or a double with 6 significant digits and its exponent
+const size_t MAX_NUMBER_CHARS = 32;
 
-        // Produce new nodes corresponding new node
-        this->augment_components(source_node, destination_node);
-        
-        return &this->all_edges[item.second];
+TextWriter& TextWriter::operator<<(const char c) {
+    if (this->used == this->buffer.size()) {
+        this->flush();
+    }
+    this->buffer[this->used++] = c;
+    return *this;
+}
+
+template <typename T>
+TextWriter& TextWriter::operator<<(const T value) {
+    static_assert(is_arithmetic<T>::value, "TextWriter formats numbers and text only");
+    if (this->used + MAX_NUMBER_CHARS > this->buffer.size()) {
+        this->flush();
+    }
+    char* first = this->buffer.data() + this->used;
+    char* last = this->buffer.data() + this->buffer.size();
+    if constexpr (is_floating_point<T>::value) {
+        this->used = to_chars(first, last, value, chars_format::general, 6).ptr - this->buffer.data();
+    } else {
+        this->used = to_chars(first, last, value).ptr - this->buffer.data();
+    }
+    return *this;
+}
+
+TextWriter& TextWriter::append(const char* text, const size_t length) {
+    if (this->used + length > this->buffer.size()) {
+        this->flush();
+        if (length > this->buffer.size()) {
+            this->output.write(text, length);
+            return *this;
+        }
     }
+    memcpy(this->buffer.data() + this->used, text, length);
+    this->used += length;
+    return *this;
 }
 
-void PathFinder::augment_components(const int source, const int destination) {
-    for (  auto &edge : this->traversed_edges) {
-        if ( (edge.second == source) && (edge.first != destination) )  {
-            cout << "+++++ Augment traversed nodes with : (" << edge.first << "," << destination << ") +++++" << endl;
-            // Mark source and destionation nodes as traversed, mark this edge as traversed
-            this->traversed_nodes.insert(source);this->traversed_nodes.insert(destination);
-            this->traversed_edges.insert(make_pair(edge.first,destination));
+void TextWriter::flush() {
+    this->output.write(this->buffer.data(), this->used);
+    this->output.flush();
+    this->used = 0;
+}
+
+// Decodes a sysfs list like "0-3,8-11"
+vector<unsigned> parse_cpu_list(const string list) {
+    vector<unsigned> values;
+    const char* cursor = list.data();
+    const char* end = list.data() + list.size();
+    unsigned first, last;
+    while (scan_value(cursor, end, first)) {
+        last = first;
+        if (cursor != end && *cursor == '-') {
+            ++cursor;
+            scan_value(cursor, end, last);
+        }
+        for (unsigned value = first; value <= last; ++value) {
+            values.push_back(value);
+        }
+        if (cursor != end && *cursor == ',') {
+            ++cursor;
         }
+    }
+    return values;
+}
 
-        if ( (edge.first == destination) && (edge.second != source) ) {
-            cout << "+++++ Augment traversed node with : (" << source << "," << edge.second << ") +++++" << endl;
-            // Mark source and destionation nodes as traversed, mark this edge as traversed
-            this->traversed_nodes.insert(source);this->traversed_nodes.insert(destination);
-            this->traversed_edges.insert(make_pair(source,edge.second));
+// Reads the nodes from /sys/devices/system/node, a machine without it is a single node of all the allowed CPUs
+void enable_numa_placement() {
+    NumaPlacement &placement = numa_placement();
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    sched_getaffinity(0, sizeof(allowed), &allowed);
+
+    string online;
+    ifstream online_file("/sys/devices/system/node/online");
+    getline(online_file, online);
+    placement.node_cpus.clear();
+    for (const unsigned node : parse_cpu_list(online)) {
+        string cpus;
+        ifstream cpu_file("/sys/devices/system/node/node" + to_string(node) + "/cpulist");
+        getline(cpu_file, cpus);
+        vector<unsigned> node_cpus;
+        for (const unsigned cpu : parse_cpu_list(cpus)) {
+            if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)) {
+                node_cpus.push_back(cpu);
+            }
+        }
+        if (!node_cpus.empty()) {
+            placement.node_cpus.push_back(node_cpus);
         }
-        
     }
+    if (placement.node_cpus.empty()) {
+        placement.node_cpus.resize(1);
+        for (unsigned cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &allowed)) {
+                placement.node_cpus[0].push_back(cpu);
+            }
+        }
+    }
+    placement.is_enabled = !placement.node_cpus.empty() && !placement.node_cpus[0].empty();
+    LOG_SUMMARY("NUMA placement over " << placement.node_cpus.size() << " nodes");
 }
 
-class SpanningTree {
+// Binary edge-list format, native byte order
+//   header | source[num_of_edges] | destination[num_of_edges] | weight[num_of_edges]
+const char BINARY_GRAPH_MAGIC[4] = {'M','S','T','G'};
+const uint32_t BINARY_GRAPH_VERSION = 1;
+const uint32_t WEIGHT_KIND_INTEGER = 0;
+const uint32_t WEIGHT_KIND_FLOATING = 1;
+
+struct BinaryGraphHeader{
+    char magic[4];
+    uint32_t version;
+    uint32_t node_width; // bytes per source/destination id
+    uint32_t weight_width; // bytes per weight
+    uint32_t weight_kind; // WEIGHT_KIND_INTEGER or WEIGHT_KIND_FLOATING
+    uint32_t reserved;
+    uint64_t num_of_nodes;
+    uint64_t num_of_edges;
+};
+
+// Size of one packed array, rounded up so that the next array stays 8-byte aligned
+size_t binary_array_size(const uint64_t count, const uint32_t width) {
+    return (count * width + 7) & ~size_t(7);
+}
+
+bool is_binary_graph(const char* begin, const char* end) {
+    return (size_t(end - begin) >= sizeof(BinaryGraphHeader)) && (memcmp(begin, BINARY_GRAPH_MAGIC, 4) == 0);
+}
+
+template <typename NodeId, typename Weight>
+BinaryGraphHeader make_binary_header(const uint64_t num_of_nodes, const uint64_t num_of_edges) {
+    BinaryGraphHeader header = {};
+    memcpy(header.magic, BINARY_GRAPH_MAGIC, 4);
+    header.version = BINARY_GRAPH_VERSION;
+    header.node_width = sizeof(NodeId);
+    header.weight_width = sizeof(Weight);
+    header.weight_kind = is_floating_point<Weight>::value ? WEIGHT_KIND_FLOATING : WEIGHT_KIND_INTEGER;
+    header.num_of_nodes = num_of_nodes;
+    header.num_of_edges = num_of_edges;
+    return header;
+}
+
+// Binary graphs are used in place, so they can only be read with the types they were written with
+template <typename NodeId, typename Weight>
+bool is_binary_layout_supported(const BinaryGraphHeader& header) {
+    const BinaryGraphHeader expected = make_binary_header<NodeId, Weight>(0, 0);
+    if (header.version != expected.version || header.node_width != expected.node_width ||
+        header.weight_width != expected.weight_width || header.weight_kind != expected.weight_kind) {
+        cerr << "Unsupported binary graph (version " << header.version << ", node width " << header.node_width
+            << ", weight width " << header.weight_width << ", weight kind " << header.weight_kind << ")" << endl;
+        return false;
+    }
+    return true;
+}
+
+// Whether a file of file_size bytes holds all the arrays its header announces
+// The edge count is bounded by the file size first, so that a crafted count can not overflow the array sizes
+bool is_binary_graph_complete(const BinaryGraphHeader& header, const size_t file_size) {
+    const uint64_t edge_bytes = 2 * uint64_t(header.node_width) + header.weight_width;
+    if (file_size < sizeof(header) || edge_bytes == 0 || header.num_of_edges > (file_size - sizeof(header)) / edge_bytes) {
+        return false;
+    }
+    return file_size >= sizeof(header) + 2 * binary_array_size(header.num_of_edges, header.node_width) + binary_array_size(header.num_of_edges, header.weight_width);
+}
+
+template <typename NodeId, typename Weight>
+class PathFinder{
     public:
-        SpanningTree() : mst_cost(0) {}
-        void add_edge(Edge* edge);
-        void print();
+        PathFinder() : num_of_nodes(0),num_of_traversed_edges(0),num_of_threads(thread::hardware_concurrency()),sort_method(SORT_AUTO),dedup_policy(DEDUP_EXACT),stats(nullptr) {} //INITIALIZER LIST SYNTAX
+        Edge<NodeId, Weight>* traverse() ;
+        bool parse_input(const string input_file);
+        bool parse_input_stream(istream& input);
+        bool parse_input_buffer(const char* begin, const char* end);
+        bool load_binary_buffer(const char* begin, const char* end);
+        bool write_binary(const string output_file);
+        void set_num_of_threads(const unsigned threads) {this->num_of_threads = threads;}
+        unsigned get_num_of_threads() {return this->num_of_threads;}
+        void set_sort_method(const int method) {this->sort_method = method;}
+        int get_sort_method() {return this->sort_method;}
+        void set_dedup_policy(const int policy) {this->dedup_policy = policy; this->edge_index.reset(policy == DEDUP_EXACT, 0);}
+        bool insert_new_edge(const NodeId s, const NodeId d, const Weight w);
+        void heapify_edges(); // must precede traverse
+        void set_stats(MstStats* run_stats) {this->stats = run_stats;}
+        MstStats* get_stats() {return this->stats;}
+        void print() ;
+        size_t get_node_size() {return this->num_of_nodes;}
+        EdgeList<NodeId, Weight>& get_edges() {return this->edges;}
+        bool check_cycle(const NodeId source, const NodeId destination);
     private:
-        int mst_cost;
-        vector<Edge> traversed_edges;
+        EdgeList<NodeId, Weight> edges;
+        Edge<NodeId, Weight> current_edge; // last edge returned by traverse
+        DisjointSet<NodeId> components;
+        size_t num_of_nodes, num_of_traversed_edges;
+        vector<pair<Weight,uint32_t>> edge_heap; // min-heap of (weight, id) of the edges not processed yet
+        bool next_edge(size_t& position);
+        unsigned num_of_threads; // worker threads used while parsing and sorting
+        int sort_method;
+        int dedup_policy; // DEDUP_EXACT, DEDUP_MIN_WEIGHT or DEDUP_NONE, applied by insert_new_edge
+        EdgeIndex<NodeId, Weight> edge_index; // edges inserted so far, for rejecting duplicates in O(1)
+        MstStats* stats; // nullptr unless statistics are asked for
+        size_t get_edge_bytes(const size_t capacity) {return capacity * (2 * sizeof(NodeId) + sizeof(Weight));}
 };
 
-void SpanningTree::add_edge(Edge* edge) {
-    // Mark this adge as traversed
-    this->traversed_edges.push_back(*edge);
+// Inputs smaller than this are parsed by a single thread, spawning workers would cost more
+const size_t MIN_PARALLEL_PARSE_BYTES = 1 << 20;
 
-    // Total weight of spanning tree
-    this->mst_cost += edge->get_weight();
+// Node ids are 0-based, an edge naming a node at or above the node count of the header is rejected
+template <typename NodeId>
+bool is_edge_in_range(const NodeId s, const NodeId d, const size_t num_of_nodes) {
+    if (s < num_of_nodes && d < num_of_nodes) {
+        return true;
+    }
+    cerr << "Edge (" << s << "," << d << ") refers to a node outside of the " << num_of_nodes << " nodes of the graph" << endl;
+    return false;
 }
 
-void SpanningTree::print(){
-    for(auto &edge : this->traversed_edges) {
-        cout << "From " << edge.get_source() << 
-            ", To: " << edge.get_destination() <<   
-            ", Cost: " << edge.get_weight() << endl;
+// Reports the token at cursor which stopped the decoding of an edge list, cursor is end when the last edge is incomplete
+// Returns false, for the callers to pass on
+bool report_malformed_edge(const char* cursor, const char* end) {
+    if (cursor == end) {
+        cerr << "The last edge of the input is incomplete" << endl;
+        return false;
+    }
+    const char* token_end = cursor;
+    while (token_end != end && token_end - cursor < 32 && !isspace(static_cast<unsigned char>(*token_end))) {
+        ++token_end;
+    }
+    cerr << "Malformed edge list, \"" << string(cursor, token_end) << "\" is not a number" << endl;
+    return false;
+}
+
+// Decodes all the (i,j,cost) triples in [begin,end) into the given buffer
+// false at the first edge with an unknown node or a token which is not a number, so every chunk of a file agrees with a serial parse
+template <typename NodeId, typename Weight>
+bool scan_edges(const char* begin, const char* end, const size_t num_of_nodes, EdgeList<NodeId, Weight>& buffer) {
+    const char* cursor = begin;
+    buffer.reserve((end - begin) / 6); // Every edge takes at least 6 bytes ("i j w\n")
+    NodeId source,destination;
+    Weight weight;
+    while (scan_value(cursor, end, source)) {
+        if (!scan_value(cursor, end, destination) || !scan_value(cursor, end, weight)) {
+            return report_malformed_edge(cursor, end);
+        }
+        if (!is_edge_in_range(source, destination, num_of_nodes)) {
+            return false;
+        }
+        buffer.push_back(source,destination,weight);
     }
-    cout << "Cost of the Spanning Tree : " << this->mst_cost << endl; 
+    return cursor == end || report_malformed_edge(cursor, end);
 }
 
-int main(void) {
-    PathFinder pf;
-    pf.parse_input(INPUT_FILE);
-    pf.sort_edges();
+// Ordered endpoints of an edge and its position in the list, what dedup_edges sorts
+template <typename NodeId>
+struct NodePair{
+    NodeId low, high;
+    uint32_t position;
+};
 
+// Parallel equivalent of inserting every edge through an EdgeIndex, edges are stable sorted on their ordered endpoints
+// so that every run of one pair lists its edges in input order. The first edge of a run survives, with the smallest
+// weight of the run under DEDUP_MIN_WEIGHT. Under DEDUP_EXACT the first edge of every weight in the run survives
+// Survivors keep their input order
+template <typename NodeId, typename Weight>
+void dedup_edges(EdgeList<NodeId, Weight>& edges, const int policy, const unsigned workers, [[maybe_unused]] MstStats* stats=nullptr) {
+    const size_t n = edges.size();
+    vector<NodePair<NodeId>> pairs(n);
+    run_tasks(workers, workers, [&](const size_t slice) {
+        for (size_t idx = n * slice / workers; idx < n * (slice + 1) / workers; ++idx) {
+            pairs[idx].low = min(edges.sources[idx], edges.destinations[idx]);
+            pairs[idx].high = max(edges.sources[idx], edges.destinations[idx]);
+            pairs[idx].position = uint32_t(idx);
+        }
+    });
+    auto is_less = [](const NodePair<NodeId>& a, const NodePair<NodeId>& b) {return a.low < b.low || (a.low == b.low && a.high < b.high);};
+    parallel_sort(pairs, workers, is_less);
+    STATS(if (stats) {
+        // The last merge of parallel_sort holds a second copy of the pairs
+        stats->note_edge_bytes(n * (2 * sizeof(NodeId) + sizeof(Weight)) + 2 * pairs.capacity() * sizeof(NodePair<NodeId>));
+    })
 
-    SpanningTree mst;
-    Edge* new_edge;
+    // Slices are moved forward to the start of a run, so that a single worker sees all the edges of a pair
+    vector<size_t> bounds(workers + 1, n);
+    bounds[0] = 0;
+    for (unsigned slice = 1; slice < workers; ++slice) {
+        size_t first = max(n * slice / workers, bounds[slice - 1]);
+        while (first > 0 && first < n && !is_less(pairs[first - 1], pairs[first])) {
+            ++first;
+        }
+        bounds[slice] = first;
+    }
+    vector<char> is_kept(n, false);
+    run_tasks(workers, workers, [&](const size_t slice) {
+        vector<pair<Weight,uint32_t>> run; // (weight, position) of the edges of one pair under DEDUP_EXACT
+        for (size_t first = bounds[slice], last; first < bounds[slice + 1]; first = last) {
+            last = first + 1;
+            while (last < n && !is_less(pairs[first], pairs[last])) {
+                ++last;
+            }
+            const uint32_t kept = pairs[first].position;
+            is_kept[kept] = true;
+            if (policy == DEDUP_MIN_WEIGHT) {
+                for (size_t idx = first + 1; idx < last; ++idx) {
+                    edges.weights[kept] = min(edges.weights[kept], edges.weights[pairs[idx].position]);
+                }
+            } else if (last - first > 1) {
+                // A NaN weight equals no other, such an edge always survives as with EdgeIndex
+                run.clear();
+                for (size_t idx = first; idx < last; ++idx) {
+                    const Weight weight = edges.weights[pairs[idx].position];
+                    if (weight == weight) {
+                        run.push_back(make_pair(weight, pairs[idx].position));
+                    } else {
+                        is_kept[pairs[idx].position] = true;
+                    }
+                }
+                stable_sort(run.begin(), run.end(), [](const pair<Weight,uint32_t>& a, const pair<Weight,uint32_t>& b) {return a.first < b.first;});
+                for (size_t idx = 0; idx < run.size(); ++idx) {
+                    is_kept[run[idx].second] = idx == 0 || run[idx - 1].first < run[idx].first;
+                }
+            }
+        }
+    });
+    vector<NodePair<NodeId>>().swap(pairs);
 
-    new_edge = pf.traverse();
-    cout << "_____" << endl;
-    while (new_edge != nullptr) {
-    
-    // means that, edge creates cycle, do not add to spanning tree
-    if  ( ! ( (new_edge->get_destination() == -1) && (new_edge->get_source() == -1) && (new_edge->get_weight() == -1) ) ){
-        mst.add_edge(new_edge); 
+    // Every slice counts its survivors, prefix sums give the place of each slice in the new list
+    vector<size_t> offsets(workers + 1, 0);
+    run_tasks(workers, workers, [&](const size_t slice) {
+        offsets[slice + 1] = count(is_kept.begin() + n * slice / workers, is_kept.begin() + n * (slice + 1) / workers, true);
+    });
+    for (unsigned slice = 0; slice < workers; ++slice) {
+        offsets[slice + 1] += offsets[slice];
     }
-    
-    new_edge = pf.traverse();
-    cout << "_____" << endl;
+    EdgeList<NodeId, Weight> survivors;
+    survivors.sources.resize(offsets[workers]);
+    survivors.destinations.resize(offsets[workers]);
+    survivors.weights.resize(offsets[workers]);
+    run_tasks(workers, workers, [&](const size_t slice) {
+        size_t target = offsets[slice];
+        for (size_t idx = n * slice / workers; idx < n * (slice + 1) / workers; ++idx) {
+            if (is_kept[idx]) {
+                survivors.sources[target] = edges.sources[idx];
+                survivors.destinations[target] = edges.destinations[idx];
+                survivors.weights[target++] = edges.weights[idx];
+            }
+        }
+    });
+    swap(edges, survivors);
+}
+
+template <typename NodeId, typename Weight>
+bool PathFinder<NodeId, Weight>::parse_input(const string input_file){
+    STATS(const auto start = chrono::steady_clock::now();)
+    // Decode straight from the mapped file, fall back to streams for pipes and special files
+    MappedFile mapped(input_file);
+    bool is_parsed;
+    if (mapped.is_open()) {
+        if (is_binary_graph(mapped.begin(), mapped.end())) {
+            is_parsed = this->load_binary_buffer(mapped.begin(), mapped.end());
+        } else {
+            is_parsed = this->parse_input_buffer(mapped.begin(), mapped.end());
+        }
+    } else {
+        ifstream input(input_file);
+        if (!input) {
+            cerr << "Can not open " << input_file << endl;
+            return false;
+        }
+        is_parsed = this->parse_input_stream(input);
+    }
+    if (!is_parsed) {
+        return false;
     }
-    
-    cout << "Minimum Spanning Tree and its components: " << endl;
-    mst.print();
+    // Parsed edges were first touched by the merging thread
+    this->edges.place_on_nodes(this->num_of_threads);
+    STATS(if (this->stats) {
+        this->stats->parse_ms += milliseconds_since(start);
+        this->stats->note_edge_bytes(this->get_edge_bytes(this->edges.sources.capacity()));
+    })
+    return true;
+}
 
-    return 0;
-}
\ No newline at end of file
+template <typename NodeId, typename Weight>
+bool PathFinder<NodeId, Weight>::parse_input_buffer(const char* begin, const char* end) {
+    const char* cursor = begin;
+    // Read first line indicating node size of graph
+    NodeId nodes;
+    if (scan_value(cursor, end, nodes)) {
+        this -> num_of_nodes = nodes;
+    }
+    this->components.reset(this->num_of_nodes);
+
+    // Split the remaining bytes into newline-aligned chunks, one per worker
+    size_t remaining = end - cursor;
+    unsigned workers = max(1u, this->num_of_threads);
+    if (remaining < MIN_PARALLEL_PARSE_BYTES) {
+        workers = 1;
+    }
+    vector<const char*> boundaries;
+    boundaries.push_back(cursor);
+    for (unsigned worker = 1; worker < workers; ++worker) {
+        const char* boundary = max(boundaries.back(), cursor + remaining * worker / workers);
+        boundary = find(boundary, end, '\n');
+        boundaries.push_back(boundary == end ? end : boundary + 1);
+    }
+    boundaries.push_back(end);
+
+    // Every worker decodes its own chunk into a private buffer
+    vector<EdgeList<NodeId, Weight>> buffers(workers);
+    vector<char> is_scanned(workers);
+    run_tasks(workers, workers, [&](const size_t chunk) {
+        is_scanned[chunk] = scan_edges(boundaries[chunk], boundaries[chunk + 1], this->num_of_nodes, buffers[chunk]);
+    });
+    if (count(is_scanned.begin(), is_scanned.end(), false) > 0) {
+        return false;
+    }
+
+    // Merge buffers in file order so that edge ids stay the same as in sequential parsing
+    size_t total_edges = 0;
+    for (auto &buffer : buffers) {
+        total_edges += buffer.size();
+    }
+    this->edges.reserve(total_edges);
+    // One EdgeIndex insert per edge would serialise the merge, with several chunks they are appended as they are
+    // and deduplicated by dedup_edges instead. The edge index then stays empty, edges inserted later are only compared with each other
+    const bool is_parallel_dedup = workers > 1 && this->dedup_policy != DEDUP_NONE;
+    if (!is_parallel_dedup) {
+        this->edge_index.reset(this->dedup_policy == DEDUP_EXACT, total_edges);
+    }
+    STATS(if (this->stats) {
+        // Chunk buffers are still held while the merged list is filled
+        size_t buffered_edges = 0;
+        for (auto &buffer : buffers) {
+            buffered_edges += buffer.sources.capacity();
+        }
+        this->stats->note_edge_bytes(this->get_edge_bytes(buffered_edges + total_edges) + this->edge_index.get_bytes());
+    })
+    if (is_parallel_dedup) {
+        for (auto &buffer : buffers) {
+            this->edges.sources.insert(this->edges.sources.end(), buffer.sources.begin(), buffer.sources.end());
+            this->edges.destinations.insert(this->edges.destinations.end(), buffer.destinations.begin(), buffer.destinations.end());
+            this->edges.weights.insert(this->edges.weights.end(), buffer.weights.begin(), buffer.weights.end());
+            buffer.clear();
+        }
+        dedup_edges(this->edges, this->dedup_policy, workers, this->stats);
+        return true;
+    }
+    for (auto &buffer : buffers) {
+        for (size_t idx = 0; idx < buffer.size(); ++idx) {
+            this->insert_new_edge(buffer.sources[idx], buffer.destinations[idx], buffer.weights[idx]);
+        }
+        buffer.clear(); // release chunk memory as soon as it is merged
+    }
+    return true;
+}
+
+template <typename NodeId, typename Weight>
+bool PathFinder<NodeId, Weight>::load_binary_buffer(const char* begin, const char* end) {
+    BinaryGraphHeader header;
+    memcpy(&header, begin, sizeof(header));
+    if (!is_binary_layout_supported<NodeId, Weight>(header)) {
+        return false;
+    }
+
+    const uint64_t edges = header.num_of_edges;
+    if (!is_binary_graph_complete(header, end - begin)) {
+        cerr << "Binary graph is truncated, expected " << edges << " edges" << endl;
+        return false;
+    }
+    const size_t id_bytes = binary_array_size(edges, header.node_width);
+
+    // Arrays are copied as a whole, edges were deduplicated while the file was written
+    const NodeId* sources = reinterpret_cast<const NodeId*>(begin + sizeof(header));
+    const NodeId* destinations = reinterpret_cast<const NodeId*>(begin + sizeof(header) + id_bytes);
+    const Weight* weights = reinterpret_cast<const Weight*>(begin + sizeof(header) + 2 * id_bytes);
+    for (uint64_t idx = 0; idx < edges; ++idx) {
+        if (!is_edge_in_range(sources[idx], destinations[idx], header.num_of_nodes)) {
+            return false;
+        }
+    }
+    this->num_of_nodes = header.num_of_nodes;
+    this->components.reset(this->num_of_nodes);
+    this->edges.sources.insert(this->edges.sources.end(), sources, sources + edges);
+    this->edges.destinations.insert(this->edges.destinations.end(), destinations, destinations + edges);
+    this->edges.weights.insert(this->edges.weights.end(), weights, weights + edges);
+    return true;
+}
+
+// Writes one packed array followed by the padding which keeps the next array aligned
+template <typename T>
+void write_binary_column(ostream& output, const vector<T>& column) {
+    const char padding[8] = {};
+    const size_t bytes = column.size() * sizeof(T);
+    output.write(reinterpret_cast<const char*>(column.data()), bytes);
+    output.write(padding, binary_array_size(column.size(), sizeof(T)) - bytes);
+}
+
+template <typename NodeId, typename Weight>
+bool PathFinder<NodeId, Weight>::write_binary(const string output_file) {
+    ofstream output(output_file, ios::binary);
+    if (!output) {
+        cerr << "Can not open " << output_file << " for writing" << endl;
+        return false;
+    }
+
+    const BinaryGraphHeader header = make_binary_header<NodeId, Weight>(this->num_of_nodes, this->edges.size());
+    output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    // Arrays are already packed, write them as they are
+    write_binary_column(output, this->edges.sources);
+    write_binary_column(output, this->edges.destinations);
+    write_binary_column(output, this->edges.weights);
+    return bool(output);
+}
+
+template <typename NodeId, typename Weight>
+bool PathFinder<NodeId, Weight>::parse_input_stream(istream& input) {
+    // Read first line indicating node size of graph
+    NodeId nodes;
+    if (input >> nodes) {
+        this -> num_of_nodes = nodes;
+    }
+    this->components.reset(this->num_of_nodes);
+    this->edge_index.reset(this->dedup_policy == DEDUP_EXACT, 0);
+
+    // Read source node, destination node and weight of the edge between these nodes
+    NodeId source,destination;
+    Weight weight;
+    while(input >> source) {
+        if (!(input >> destination >> weight)) {
+            input.clear();
+            string token;
+            input >> token;
+            return report_malformed_edge(token.data(), token.data() + token.size());
+        }
+        if (!this->insert_new_edge(source,destination,weight)) {
+            return false;
+        }
+    }
+    if (!input.eof()) {
+        input.clear();
+        string token;
+        input >> token;
+        return report_malformed_edge(token.data(), token.data() + token.size());
+    }
+    return true;
+}
+
+template <typename NodeId, typename Weight>
+bool PathFinder<NodeId, Weight>::insert_new_edge(const NodeId s, const NodeId d, const Weight w) {
+    // Stores tuple of i,j,weight corresponding edge
+    if (!is_edge_in_range(s, d, this->num_of_nodes)) {
+        return false;
+    }
+
+    // Add this new-coming edge
+    this->edges.push_back(s,d,w);
+    if (this->dedup_policy == DEDUP_NONE) {
+        return true;
+    }
+
+    // if (x,y,w) already exist, do not add (x,y,w) or (y,x,w) again
+    // with DEDUP_MIN_WEIGHT any (x,y) or (y,x) counts, the kept edge takes the smaller weight
+    const size_t existing = this->edge_index.find_or_insert(this->edges, this->edges.size() - 1);
+    if (existing != EDGE_NOT_FOUND) {
+        LOG_TRACE("Can not insert edge (" << s << "," << d << "). Since there exist another edge ("
+        <<   this->edges.sources[existing] << "," << this->edges.destinations[existing] << ") in the graph");
+        this->edges.weights[existing] = min(this->edges.weights[existing], w);
+        this->edges.sources.pop_back();
+        this->edges.destinations.pop_back();
+        this->edges.weights.pop_back();
+    }
+    return true;
+}
+
+template <typename NodeId, typename Weight>
+void PathFinder<NodeId, Weight>::print() {
+    for (size_t idx = 0; idx < this->edges.size(); ++idx) {
+        cout << "Edge[" << idx <<"] => Source : " << this->edges.sources[idx]
+            << ", Destination: " << this->edges.destinations[idx]
+            << ", Weight: " << this->edges.weights[idx]
+            << endl;
+    }
+}
+
+template <typename NodeId, typename Weight>
+bool PathFinder<NodeId, Weight>::check_cycle(const NodeId source, const NodeId destination) {
+    LOG_TRACE("Will check cycles for (" << source << "," << destination << ")");
+    // Both nodes are already reachable from each other, so connecting them would close a loop
+    if (this->components.is_connected(source, destination)) {
+        LOG_TRACE("CYCLE exist since " << source << " and " << destination << " are in the same component");
+        return true;
+    }
+    return false;
+}
+
+template <typename NodeId, typename Weight>
+void PathFinder<NodeId, Weight>::heapify_edges() {
+    STATS(const auto start = chrono::steady_clock::now();)
+    this->edge_heap.resize(this->edges.size());
+    for (size_t idx = 0; idx < this->edges.size(); ++idx) {
+        this->edge_heap[idx] = make_pair(this->edges.weights[idx], uint32_t(idx));
+    }
+    make_heap(this->edge_heap.begin(), this->edge_heap.end(), greater<pair<Weight,uint32_t>>()); // O(E)
+    STATS(if (this->stats) {
+        this->stats->sort_ms += milliseconds_since(start);
+        this->stats->note_edge_bytes(this->get_edge_bytes(this->edges.sources.capacity()) + this->edge_heap.capacity() * sizeof(pair<Weight,uint32_t>));
+    })
+}
+
+template <typename NodeId, typename Weight>
+bool PathFinder<NodeId, Weight>::next_edge(size_t& position) {
+    // Lightest remaining edge is popped from the heap, O(log E) per examined edge
+    if (this->edge_heap.empty()) {
+        return false;
+    }
+    pop_heap(this->edge_heap.begin(), this->edge_heap.end(), greater<pair<Weight,uint32_t>>());
+    position = this->edge_heap.back().second;
+    this->edge_heap.pop_back();
+    return true;
+}
+
+template <typename NodeId, typename Weight>
+Edge<NodeId, Weight>* PathFinder<NodeId, Weight>::traverse() {
+    NodeId source_node, destination_node;
+    // If all nodes are traversed, which means containing node-1 edges, termination conditition
+    if (this->num_of_traversed_edges + 1 >= this->num_of_nodes) {
+        LOG_SUMMARY("Spanning tree now contains " << this->num_of_traversed_edges << " edges. Terminating...");
+        STATS(if (this->stats) this->stats->union_find = this->components.get_counters();)
+        return nullptr;
+    }
+
+    //heapified by weight of the edge
+    //resumes from the edge following the last processed one
+    size_t position;
+    while (this->next_edge(position)) {
+        source_node = this->edges.sources[position];
+        destination_node = this->edges.destinations[position];
+
+        LOG_TRACE("Processing edge (" << source_node << "," << destination_node << ") with weight " << this->edges.weights[position]);
+        STATS(if (this->stats) this->stats->edges_examined ++;)
+
+        // Do not create cycle
+        if (check_cycle(source_node, destination_node)) {
+            LOG_TRACE("Edge (" << source_node << "," << destination_node << ") will create a loop. Skipping...");
+            STATS(if (this->stats) this->stats->edges_rejected ++;)
+            continue;
+        }
+
+        // Merge components of source and destination nodes, mark this edge as traversed
+        this->components.unite(source_node, destination_node);
+        this->num_of_traversed_edges ++ ;
+
+        this->current_edge = Edge<NodeId, Weight>(source_node, destination_node, this->edges.weights[position]);
+        return &this->current_edge;
+    }
+
+    LOG_SUMMARY("All edges are processed. Terminating...");
+    STATS(if (this->stats) this->stats->union_find = this->components.get_counters();)
+    return nullptr;
+}
+
+// Non-owning view of an edge list kept in three separate arrays, as EdgeList and binary graphs store them
+template <typename NodeId, typename Weight>
+struct EdgeSpan{
+    EdgeSpan(const NodeId* s, const NodeId* d, const Weight* w, const size_t edges, const size_t nodes)
+        : sources(s), destinations(d), weights(w), num_of_edges(edges), num_of_nodes(nodes) {}
+    EdgeSpan(const EdgeList<NodeId, Weight>& edges, const size_t nodes)
+        : EdgeSpan(edges.sources.data(), edges.destinations.data(), edges.weights.data(), edges.size(), nodes) {}
+    const NodeId* sources;
+    const NodeId* destinations;
+    const Weight* weights;
+    size_t num_of_edges, num_of_nodes;
+};
+
+template <typename NodeId, typename Weight>
+struct MstResult{
+    vector<Edge<NodeId, Weight>> edges; // in the order they joined the tree
+    Cost<Weight> cost = 0;
+};
+
+template <typename NodeId, typename Weight>
+class SpanningTree {
+    public:
+        SpanningTree() : mst_cost(0) {}
+        SpanningTree(MstResult<NodeId, Weight>&& result) : mst_cost(result.cost), traversed_edges(move(result.edges)) {}
+        void reserve(const size_t num_of_edges) {this->traversed_edges.reserve(num_of_edges);}
+        void add_edge(const NodeId source, const NodeId destination, const Weight weight);
+        void print();
+        void print_forest(const size_t num_of_nodes);
+        bool write_binary(const string output_file, const size_t num_of_nodes);
+        bool read_binary(const string input_file, size_t& num_of_nodes); // replaces the tree, false if the file is missing or damaged
+        const vector<Edge<NodeId, Weight>>& get_edges() {return this->traversed_edges;}
+        Cost<Weight> get_cost() {return this->mst_cost;}
+    private:
+        Cost<Weight> mst_cost;
+        vector<Edge<NodeId, Weight>> traversed_edges;
+};
+
+template <typename NodeId, typename Weight>
+void SpanningTree<NodeId, Weight>::add_edge(const NodeId source, const NodeId destination, const Weight weight) {
+    // Mark this adge as traversed
+    this->traversed_edges.emplace_back(source, destination, weight);
+
+    // Total weight of spanning tree
+    this->mst_cost += weight;
+}
+
+template <typename NodeId, typename Weight>
+void SpanningTree<NodeId, Weight>::print(){
+    TextWriter writer(cout);
+    for(auto &edge : this->traversed_edges) {
+        writer << "From " << edge.get_source() <<
+            ", To: " << edge.get_destination() <<
+            ", Cost: " << edge.get_weight() << '\n';
+    }
+    writer << "Cost of the Spanning Tree : " << this->mst_cost << '\n';
+}
+
+// Tree edges in the binary edge-list format, so that a dumped tree loads back as a graph
+// Columns are gathered from the edges in blocks, the file is written in a few large writes
+template <typename NodeId, typename Weight>
+bool SpanningTree<NodeId, Weight>::write_binary(const string output_file, const size_t num_of_nodes) {
+    ofstream output(output_file, ios::binary);
+    if (!output) {
+        cerr << "Can not open " << output_file << " for writing" << endl;
+        return false;
+    }
+    const size_t num_of_edges = this->traversed_edges.size();
+    const BinaryGraphHeader header = make_binary_header<NodeId, Weight>(num_of_nodes, num_of_edges);
+    output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    const size_t block_edges = TEXT_WRITER_BYTES / sizeof(Weight);
+    vector<NodeId> ids;
+    vector<Weight> weights;
+    const char padding[8] = {};
+    for (int field = 0; field < 3; ++field) {
+        for (size_t first = 0; first < num_of_edges; first += block_edges) {
+            const size_t last = min(first + block_edges, num_of_edges);
+            if (field < 2) {
+                ids.resize(last - first);
+                for (size_t idx = first; idx < last; ++idx) {
+                    const Edge<NodeId, Weight> &edge = this->traversed_edges[idx];
+                    ids[idx - first] = (field == 0) ? edge.get_source() : edge.get_destination();
+                }
+                output.write(reinterpret_cast<const char*>(ids.data()), ids.size() * sizeof(NodeId));
+            } else {
+                weights.resize(last - first);
+                for (size_t idx = first; idx < last; ++idx) {
+                    weights[idx - first] = this->traversed_edges[idx].get_weight();
+                }
+                output.write(reinterpret_cast<const char*>(weights.data()), weights.size() * sizeof(Weight));
+            }
+        }
+        const size_t width = (field < 2) ? sizeof(NodeId) : sizeof(Weight);
+        output.write(padding, binary_array_size(num_of_edges, width) - num_of_edges * width);
+    }
+    return bool(output);
+}
+
+template <typename NodeId, typename Weight>
+void SpanningTree<NodeId, Weight>::print_forest(const size_t num_of_nodes) {
+    // Group edges by the component they belong to, trees are ordered by their smallest node
+    const size_t NO_TREE = size_t(-1);
+    DisjointSet<NodeId> forest(num_of_nodes);
+    for (auto &edge : this->traversed_edges) {
+        forest.unite(edge.get_source(), edge.get_destination());
+    }
+    vector<size_t> tree_of_root(num_of_nodes, NO_TREE), tree_sizes;
+    for (size_t node = 0; node < num_of_nodes; ++node) {
+        size_t &tree = tree_of_root[forest.find(NodeId(node))];
+        if (tree == NO_TREE) {
+            tree = tree_sizes.size();
+            tree_sizes.push_back(0);
+        }
+        tree_sizes[tree] ++;
+    }
+    vector<vector<Edge<NodeId, Weight>>> tree_edges(tree_sizes.size());
+    vector<Cost<Weight>> tree_costs(tree_sizes.size(), 0);
+    for (auto &edge : this->traversed_edges) {
+        const size_t tree = tree_of_root[forest.find(edge.get_source())];
+        tree_edges[tree].push_back(edge);
+        tree_costs[tree] += edge.get_weight();
+    }
+
+    TextWriter writer(cout);
+    size_t num_of_isolated_nodes = 0, num_of_printed_trees = 0;
+    for (size_t tree = 0; tree < tree_sizes.size(); ++tree) {
+        if (tree_sizes[tree] == 1) {
+            num_of_isolated_nodes ++;
+            continue;
+        }
+        writer << "Tree " << num_of_printed_trees++ << " : " << tree_sizes[tree] << " nodes, Cost : " << tree_costs[tree] << '\n';
+        for (auto &edge : tree_edges[tree]) {
+            writer << "From " << edge.get_source() <<
+                ", To: " << edge.get_destination() <<
+                ", Cost: " << edge.get_weight() << '\n';
+        }
+    }
+    writer << "Isolated nodes : " << num_of_isolated_nodes << '\n';
+    writer << "Number of trees : " << tree_sizes.size() << '\n';
+    writer << "Cost of the Spanning Forest : " << this->mst_cost << '\n';
+}
+
+// Edges are added back in the order they were written, so the cost is summed in the same order as when the tree was built
+template <typename NodeId, typename Weight>
+bool SpanningTree<NodeId, Weight>::read_binary(const string input_file, size_t& num_of_nodes) {
+    MappedFile mapped(input_file);
+    if (!mapped.is_open() || !is_binary_graph(mapped.begin(), mapped.end())) {
+        return false;
+    }
+    BinaryGraphHeader header;
+    memcpy(&header, mapped.begin(), sizeof(header));
+    if (!is_binary_layout_supported<NodeId, Weight>(header)) {
+        return false;
+    }
+    if (!is_binary_graph_complete(header, mapped.size())) {
+        return false;
+    }
+    const size_t num_of_edges = header.num_of_edges;
+    const size_t id_bytes = binary_array_size(num_of_edges, sizeof(NodeId));
+
+    const NodeId* sources = reinterpret_cast<const NodeId*>(mapped.begin() + sizeof(header));
+    const NodeId* destinations = reinterpret_cast<const NodeId*>(mapped.begin() + sizeof(header) + id_bytes);
+    const Weight* weights = reinterpret_cast<const Weight*>(mapped.begin() + sizeof(header) + 2 * id_bytes);
+    // A damaged or stale file is a miss, the tree is left as it was and gets rebuilt
+    if (num_of_edges >= max<uint64_t>(header.num_of_nodes, 1)) {
+        return false;
+    }
+    for (size_t idx = 0; idx < num_of_edges; ++idx) {
+        if (sources[idx] >= header.num_of_nodes || destinations[idx] >= header.num_of_nodes) {
+            return false;
+        }
+    }
+    *this = SpanningTree<NodeId, Weight>();
+    this->reserve(num_of_edges);
+    for (size_t idx = 0; idx < num_of_edges; ++idx) {
+        this->add_edge(sources[idx], destinations[idx], weights[idx]);
+    }
+    num_of_nodes = header.num_of_nodes;
+    return true;
+}
+
+// Scratch memory of the Kruskal kernel, reused from graph to graph
+template <typename NodeId, typename Weight>
+struct MstWorkspace{
+    vector<uint32_t> order;
+    SortBuffers<Weight> sort_buffers;
+    DisjointSet<NodeId> components;
+    vector<char> is_cycle; // block filter result of every edge of the current block
+};
+
+// Sorted edges are scanned in blocks of this many, a block is filtered in parallel once most edges of the previous one closed cycles
+const size_t KRUSKAL_FILTER_BLOCK_EDGES = 1 << 16;
+
+// Kruskal kernel of compute_mst and MstBatch, writes the at most V-1 tree edges to tree and returns their number
+template <typename NodeId, typename Weight>
+size_t build_kruskal(const EdgeSpan<NodeId, Weight>& edges, MstWorkspace<NodeId, Weight>& workspace, const int sort_method, const unsigned workers,
+                     Edge<NodeId, Weight>* tree, Cost<Weight>& cost, [[maybe_unused]] MstStats* stats=nullptr) {
+    cost = 0;
+    if (edges.num_of_nodes == 0) {
+        return 0;
+    }
+    STATS(auto start = chrono::steady_clock::now();)
+    sort_order_by_weight(edges.weights, edges.num_of_edges, sort_method, workers, workspace.order, workspace.sort_buffers);
+    workspace.components.reset(edges.num_of_nodes);
+    STATS(if (stats) {
+        const SortBuffers<Weight> &buffers = workspace.sort_buffers;
+        stats->sort_ms += milliseconds_since(start);
+        stats->note_edge_bytes(edges.num_of_edges * (2 * sizeof(NodeId) + sizeof(Weight)) + workspace.order.capacity() * sizeof(uint32_t) +
+            (buffers.items.capacity() + buffers.buffer.capacity()) * sizeof(RadixItem<Weight>) + buffers.keys.capacity() * sizeof(pair<Weight,uint32_t>));
+        start = chrono::steady_clock::now();
+    })
+
+    // Workers test the edges of a block against the union-find as the previous blocks left it, nobody unites meanwhile
+    // An edge they find inside one component closes a cycle for good, as components only grow, and only the others
+    // go through the sequential unions. The sequential pass alone decides while most edges still join the tree
+    const vector<uint32_t> &order = workspace.order;
+    DisjointSet<NodeId> &components = workspace.components;
+    const unsigned num_of_slices = max(1u, workers);
+    size_t num_of_tree_edges = 0, num_of_examined_edges = 0, num_of_filtered_edges = 0;
+    bool is_filtering = false;
+    for (size_t first = 0; first < order.size() && num_of_tree_edges + 1 < edges.num_of_nodes; first += KRUSKAL_FILTER_BLOCK_EDGES) {
+        const size_t last = min(first + KRUSKAL_FILTER_BLOCK_EDGES, order.size());
+        if (is_filtering) {
+            workspace.is_cycle.resize(last - first);
+            run_tasks(num_of_slices, num_of_slices, [&](const size_t slice) {
+                for (size_t idx = first + (last - first) * slice / num_of_slices; idx < first + (last - first) * (slice + 1) / num_of_slices; ++idx) {
+                    workspace.is_cycle[idx - first] = components.find_root(edges.sources[order[idx]]) == components.find_root(edges.destinations[order[idx]]);
+                }
+            });
+        }
+
+        size_t num_of_rejected_edges = 0;
+        for (size_t idx = first; idx < last && num_of_tree_edges + 1 < edges.num_of_nodes; ++idx) {
+            const uint32_t position = order[idx];
+            num_of_examined_edges ++;
+            if (is_filtering && workspace.is_cycle[idx - first]) {
+                num_of_filtered_edges ++;
+                num_of_rejected_edges ++;
+            } else if (components.unite(edges.sources[position], edges.destinations[position])) {
+                tree[num_of_tree_edges++] = Edge<NodeId, Weight>(edges.sources[position], edges.destinations[position], edges.weights[position]);
+                cost += edges.weights[position];
+            } else {
+                num_of_rejected_edges ++;
+            }
+        }
+        is_filtering = workers > 1 && 2 * num_of_rejected_edges >= last - first;
+    }
+    STATS(if (stats) {
+        stats->scan_ms += milliseconds_since(start);
+        stats->edges_examined += num_of_examined_edges;
+        stats->edges_rejected += num_of_examined_edges - num_of_tree_edges;
+        stats->edges_filtered += num_of_filtered_edges;
+        stats->add(workspace.components.get_counters());
+    })
+    return num_of_tree_edges;
+}
+
+// Library entry point, Kruskal over a weight order of the span which never copies or reorders the input arrays
+// result is cleared and refilled, so a caller computing many trees keeps reusing its storage
+// Statistics of the call are added to stats when it is given
+template <typename NodeId, typename Weight>
+void compute_mst(const EdgeSpan<NodeId, Weight>& edges, MstResult<NodeId, Weight>& result, const int sort_method=SORT_AUTO, const unsigned workers=1,
+                 MstStats* stats=nullptr) {
+    MstWorkspace<NodeId, Weight> workspace;
+    result.edges.resize(edges.num_of_nodes > 0 ? edges.num_of_nodes - 1 : 0);
+    result.edges.resize(build_kruskal(edges, workspace, sort_method, workers, result.edges.data(), result.cost, stats));
+}
+
+template <typename NodeId, typename Weight>
+MstResult<NodeId, Weight> compute_mst(const EdgeSpan<NodeId, Weight>& edges, const int sort_method=SORT_AUTO, const unsigned workers=1,
+                                      MstStats* stats=nullptr) {
+    MstResult<NodeId, Weight> result;
+    compute_mst(edges, result, sort_method, workers, stats);
+    return result;
+}
+
+// Computes the trees of many independent graphs, idle workers take the next graph one at a time
+// Every worker keeps its own workspace and all the trees share one edge array, so once a batch has been built
+// batches of graphs of similar size run without going through the allocator
+template <typename NodeId, typename Weight>
+class MstBatch{
+    public:
+        MstBatch(const unsigned workers) : num_of_workers(max(1u, workers)), workspaces(num_of_workers) {}
+        void build(const vector<EdgeSpan<NodeId, Weight>>& graphs);
+        size_t size() {return this->costs.size();}
+        const Edge<NodeId, Weight>* get_tree(const size_t graph) {return this->tree_edges.data() + this->offsets[graph];}
+        size_t get_tree_size(const size_t graph) {return this->tree_sizes[graph];}
+        Cost<Weight> get_cost(const size_t graph) {return this->costs[graph];}
+    private:
+        unsigned num_of_workers;
+        vector<MstWorkspace<NodeId, Weight>> workspaces; // one per worker, kept between batches
+        vector<Edge<NodeId, Weight>> tree_edges; // tree of graph g starts at offsets[g]
+        vector<size_t> offsets, tree_sizes;
+        vector<Cost<Weight>> costs;
+};
+
+template <typename NodeId, typename Weight>
+void MstBatch<NodeId, Weight>::build(const vector<EdgeSpan<NodeId, Weight>>& graphs) {
+    // A tree of V nodes has at most V-1 edges, which fixes the place of every tree in the shared array
+    const size_t num_of_graphs = graphs.size();
+    this->offsets.resize(num_of_graphs + 1);
+    this->offsets[0] = 0;
+    for (size_t graph = 0; graph < num_of_graphs; ++graph) {
+        const size_t nodes = graphs[graph].num_of_nodes;
+        this->offsets[graph + 1] = this->offsets[graph] + (nodes > 0 ? nodes - 1 : 0);
+    }
+    this->tree_edges.resize(this->offsets[num_of_graphs]);
+    this->tree_sizes.resize(num_of_graphs);
+    this->costs.resize(num_of_graphs);
+
+    atomic<size_t> next_graph(0);
+    run_tasks(this->num_of_workers, this->num_of_workers, [&](const size_t worker) {
+        MstWorkspace<NodeId, Weight> &workspace = this->workspaces[worker];
+        for (size_t graph = next_graph++; graph < num_of_graphs; graph = next_graph++) {
+            this->tree_sizes[graph] = build_kruskal(graphs[graph], workspace, SORT_AUTO, 1, this->tree_edges.data() + this->offsets[graph], this->costs[graph]);
+        }
+    });
+}
+
+const size_t FILTER_KRUSKAL_BASE_EDGES = 1 << 10;
+
+template <typename NodeId, typename Weight>
+class FilterKruskal{
+    public:
+        FilterKruskal(const size_t nodes) : num_of_nodes(nodes), num_of_tree_edges(0), components(nodes), random_state(0x9e3779b97f4a7c15ull) {}
+        void build(EdgeList<NodeId, Weight>& edges, SpanningTree<NodeId, Weight>& mst); // reorders edges
+    private:
+        void filter_kruskal(EdgeList<NodeId, Weight>& edges, size_t first, size_t last, SpanningTree<NodeId, Weight>& mst);
+        void kruskal(EdgeList<NodeId, Weight>& edges, const size_t first, const size_t last, SpanningTree<NodeId, Weight>& mst);
+        size_t filter(EdgeList<NodeId, Weight>& edges, const size_t first, const size_t last);
+        Weight pick_pivot(EdgeList<NodeId, Weight>& edges, const size_t first, const size_t last);
+        bool is_complete() {return this->num_of_tree_edges + 1 >= this->num_of_nodes;}
+        size_t num_of_nodes, num_of_tree_edges;
+        DisjointSet<NodeId> components;
+        uint64_t random_state;
+};
+
+template <typename NodeId, typename Weight>
+void FilterKruskal<NodeId, Weight>::build(EdgeList<NodeId, Weight>& edges, SpanningTree<NodeId, Weight>& mst) {
+    this->filter_kruskal(edges, 0, edges.size(), mst);
+}
+
+template <typename NodeId, typename Weight>
+void FilterKruskal<NodeId, Weight>::filter_kruskal(EdgeList<NodeId, Weight>& edges, size_t first, size_t last, SpanningTree<NodeId, Weight>& mst) {
+    // Light part is handled by recursion, heavy part by looping for keeping the stack shallow
+    while (!this->is_complete() && first < last) {
+        if (last - first <= FILTER_KRUSKAL_BASE_EDGES) {
+            this->kruskal(edges, first, last, mst);
+            return;
+        }
+
+        // Three-way partition : [first,light) < pivot, [light,heavy) == pivot, [heavy,last) > pivot
+        const Weight pivot = this->pick_pivot(edges, first, last);
+        size_t light = first, heavy = last, idx = first;
+        while (idx < heavy) {
+            if (edges.weights[idx] < pivot) {
+                edges.swap_edges(idx++, light++);
+            } else if (edges.weights[idx] > pivot) {
+                edges.swap_edges(idx, --heavy);
+            } else {
+                ++idx;
+            }
+        }
+
+        this->filter_kruskal(edges, first, light, mst);
+
+        // Edges with the pivot weight need no sorting among themselves
+        const size_t equal_last = this->filter(edges, light, heavy);
+        for (size_t position = light; position < equal_last && !this->is_complete(); ++position) {
+            if (this->components.unite(edges.sources[position], edges.destinations[position])) {
+                mst.add_edge(edges.sources[position], edges.destinations[position], edges.weights[position]);
+                this->num_of_tree_edges ++;
+            }
+        }
+
+        // Drop heavy edges which would close a cycle with the tree built so far
+        first = heavy;
+        last = this->filter(edges, first, last);
+    }
+}
+
+template <typename NodeId, typename Weight>
+void FilterKruskal<NodeId, Weight>::kruskal(EdgeList<NodeId, Weight>& edges, const size_t first, const size_t last, SpanningTree<NodeId, Weight>& mst) {
+    vector<pair<Weight,uint32_t>> order;
+    order.reserve(last - first);
+    for (size_t position = first; position < last; ++position) {
+        order.push_back(make_pair(edges.weights[position], uint32_t(position)));
+    }
+    sort(order.begin(), order.end());
+
+    for (auto &item : order) {
+        if (this->is_complete()) {
+            return;
+        }
+        const NodeId source = edges.sources[item.second], destination = edges.destinations[item.second];
+        if (this->components.unite(source, destination)) {
+            mst.add_edge(source, destination, item.first);
+            this->num_of_tree_edges ++;
+        }
+    }
+}
+
+template <typename NodeId, typename Weight>
+size_t FilterKruskal<NodeId, Weight>::filter(EdgeList<NodeId, Weight>& edges, const size_t first, const size_t last) {
+    // Compact edges connecting different components to the front of the range
+    size_t kept = first;
+    for (size_t position = first; position < last; ++position) {
+        if (!this->components.is_connected(edges.sources[position], edges.destinations[position])) {
+            if (kept != position) {
+                edges.swap_edges(kept, position);
+            }
+            ++kept;
+        }
+    }
+    return kept;
+}
+
+template <typename NodeId, typename Weight>
+Weight FilterKruskal<NodeId, Weight>::pick_pivot(EdgeList<NodeId, Weight>& edges, const size_t first, const size_t last) {
+    // Median of three random samples
+    Weight samples[3];
+    for (auto &sample : samples) {
+        this->random_state ^= this->random_state << 13;
+        this->random_state ^= this->random_state >> 7;
+        this->random_state ^= this->random_state << 17;
+        sample = edges.weights[first + this->random_state % (last - first)];
+    }
+    return max(min(samples[0], samples[1]), min(max(samples[0], samples[1]), samples[2]));
+}
+
+// Position of the smallest of keys[0, n), the first one among equal keys
+template <typename Weight>
+size_t min_key_position_scalar(const Weight* keys, const size_t n) {
+    size_t best = 0;
+    for (size_t idx = 1; idx < n; ++idx) {
+        if (keys[idx] < keys[best]) {
+            best = idx;
+        }
+    }
+    return best;
+}
+
+#ifdef MST_SIMD_X86
+// Vector kernels cover the weight types main instantiates, any other type takes the scalar loop
+template <typename Weight>
+constexpr bool is_simd_weight() {
+    return is_same<Weight, int32_t>::value || is_same<Weight, int64_t>::value || is_same<Weight, float>::value || is_same<Weight, double>::value;
+}
+
+const int SIMD_NONE = 0;
+const int SIMD_AVX2 = 1;
+const int SIMD_AVX512 = 2;
+
+int simd_level() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return SIMD_AVX512;
+    }
+    return __builtin_cpu_supports("avx2") ? SIMD_AVX2 : SIMD_NONE;
+}
+
+template <typename Weight>
+__attribute__((target("avx2"))) inline auto avx2_load(const Weight* keys) {
+    if constexpr (is_same<Weight, float>::value) {
+        return _mm256_loadu_ps(keys);
+    } else if constexpr (is_same<Weight, double>::value) {
+        return _mm256_loadu_pd(keys);
+    } else {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys));
+    }
+}
+
+template <typename Weight>
+__attribute__((target("avx2"))) inline auto avx2_broadcast(const Weight key) {
+    if constexpr (is_same<Weight, float>::value) {
+        return _mm256_set1_ps(key);
+    } else if constexpr (is_same<Weight, double>::value) {
+        return _mm256_set1_pd(key);
+    } else if constexpr (sizeof(Weight) == 4) {
+        return _mm256_set1_epi32(key);
+    } else {
+        return _mm256_set1_epi64x(key);
+    }
+}
+
+template <typename Weight, typename Vector>
+__attribute__((target("avx2"))) inline Vector avx2_min(const Vector a, const Vector b) {
+    if constexpr (is_same<Weight, float>::value) {
+        return _mm256_min_ps(a, b);
+    } else if constexpr (is_same<Weight, double>::value) {
+        return _mm256_min_pd(a, b);
+    } else if constexpr (sizeof(Weight) == 4) {
+        return _mm256_min_epi32(a, b);
+    } else {
+        return _mm256_blendv_epi8(a, b, _mm256_cmpgt_epi64(a, b)); // AVX2 has no 64-bit integer min
+    }
+}
+
+// Bit i is set when lane i of a equals lane i of b
+template <typename Weight, typename Vector>
+__attribute__((target("avx2"))) inline unsigned avx2_equal_lanes(const Vector a, const Vector b) {
+    if constexpr (is_same<Weight, float>::value) {
+        return _mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_EQ_OQ));
+    } else if constexpr (is_same<Weight, double>::value) {
+        return _mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_EQ_OQ));
+    } else if constexpr (sizeof(Weight) == 4) {
+        return _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(a, b)));
+    } else {
+        return _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(a, b)));
+    }
+}
+
+// One pass takes the minimum of whole vectors, a second one finds its first position
+// The last vector is loaded overlapping the previous one, so there is no scalar tail
+// NaN keys are skipped as by min_key_position_scalar, so the minimum is always found again in the second pass
+template <typename Weight>
+__attribute__((target("avx2"))) size_t min_key_position_avx2(const Weight* keys, const size_t n) {
+    const size_t WIDTH = 32 / sizeof(Weight);
+    if (n < WIDTH) {
+        return min_key_position_scalar(keys, n);
+    }
+    if (keys[0] != keys[0]) {
+        return 0; // a NaN first key is never replaced by the scalar comparison either
+    }
+    // min gives its second operand when either one is NaN, so NaN keys never get into best
+    auto best = avx2_broadcast(keys[0]);
+    for (size_t idx = 0; idx + WIDTH <= n; idx += WIDTH) {
+        best = avx2_min<Weight>(avx2_load(keys + idx), best);
+    }
+    best = avx2_min<Weight>(avx2_load(keys + n - WIDTH), best);
+    Weight lanes[WIDTH];
+    memcpy(lanes, &best, sizeof(lanes));
+    const auto target = avx2_broadcast(lanes[min_key_position_scalar(lanes, WIDTH)]);
+
+    for (size_t idx = 0; idx + WIDTH <= n; idx += WIDTH) {
+        if (const unsigned equal = avx2_equal_lanes<Weight>(avx2_load(keys + idx), target)) {
+            return idx + __builtin_ctz(equal);
+        }
+    }
+    return n - WIDTH + __builtin_ctz(avx2_equal_lanes<Weight>(avx2_load(keys + n - WIDTH), target));
+}
+
+template <typename Weight>
+__attribute__((target("avx512f"))) inline auto avx512_load(const Weight* keys) {
+    if constexpr (is_same<Weight, float>::value) {
+        return _mm512_loadu_ps(keys);
+    } else if constexpr (is_same<Weight, double>::value) {
+        return _mm512_loadu_pd(keys);
+    } else {
+        return _mm512_loadu_si512(keys);
+    }
+}
+
+template <typename Weight>
+__attribute__((target("avx512f"))) inline auto avx512_broadcast(const Weight key) {
+    if constexpr (is_same<Weight, float>::value) {
+        return _mm512_set1_ps(key);
+    } else if constexpr (is_same<Weight, double>::value) {
+        return _mm512_set1_pd(key);
+    } else if constexpr (sizeof(Weight) == 4) {
+        return _mm512_set1_epi32(key);
+    } else {
+        return _mm512_set1_epi64(key);
+    }
+}
+
+template <typename Weight, typename Vector>
+__attribute__((target("avx512f"))) inline Vector avx512_min(const Vector a, const Vector b) {
+    // Unmasked forms trip -Wmaybe-uninitialized on GCC 12, a full mask gives the same result
+    if constexpr (is_same<Weight, float>::value) {
+        return _mm512_mask_min_ps(a, __mmask16(-1), a, b);
+    } else if constexpr (is_same<Weight, double>::value) {
+        return _mm512_mask_min_pd(a, __mmask8(-1), a, b);
+    } else if constexpr (sizeof(Weight) == 4) {
+        return _mm512_mask_min_epi32(a, __mmask16(-1), a, b);
+    } else {
+        return _mm512_mask_min_epi64(a, __mmask8(-1), a, b);
+    }
+}
+
+template <typename Weight, typename Vector>
+__attribute__((target("avx512f"))) inline unsigned avx512_equal_lanes(const Vector a, const Vector b) {
+    if constexpr (is_same<Weight, float>::value) {
+        return _mm512_cmp_ps_mask(a, b, _CMP_EQ_OQ);
+    } else if constexpr (is_same<Weight, double>::value) {
+        return _mm512_cmp_pd_mask(a, b, _CMP_EQ_OQ);
+    } else if constexpr (sizeof(Weight) == 4) {
+        return _mm512_cmpeq_epi32_mask(a, b);
+    } else {
+        return _mm512_cmpeq_epi64_mask(a, b);
+    }
+}
+
+// Same two passes as min_key_position_avx2 over 64-byte vectors
+template <typename Weight>
+__attribute__((target("avx512f"))) size_t min_key_position_avx512(const Weight* keys, const size_t n) {
+    const size_t WIDTH = 64 / sizeof(Weight);
+    if (n < WIDTH) {
+        return min_key_position_scalar(keys, n);
+    }
+    if (keys[0] != keys[0]) {
+        return 0; // a NaN first key is never replaced by the scalar comparison either
+    }
+    // min gives its second operand when either one is NaN, so NaN keys never get into best
+    auto best = avx512_broadcast(keys[0]);
+    for (size_t idx = 0; idx + WIDTH <= n; idx += WIDTH) {
+        best = avx512_min<Weight>(avx512_load(keys + idx), best);
+    }
+    best = avx512_min<Weight>(avx512_load(keys + n - WIDTH), best);
+    Weight lanes[WIDTH];
+    memcpy(lanes, &best, sizeof(lanes));
+    const auto target = avx512_broadcast(lanes[min_key_position_scalar(lanes, WIDTH)]);
+
+    for (size_t idx = 0; idx + WIDTH <= n; idx += WIDTH) {
+        if (const unsigned equal = avx512_equal_lanes<Weight>(avx512_load(keys + idx), target)) {
+            return idx + __builtin_ctz(equal);
+        }
+    }
+    return n - WIDTH + __builtin_ctz(avx512_equal_lanes<Weight>(avx512_load(keys + n - WIDTH), target));
+}
+#endif
+
+// Position of the smallest of keys[0, n), n > 0, through the widest vector kernel the CPU supports
+template <typename Weight>
+size_t min_key_position(const Weight* keys, const size_t n) {
+#ifdef MST_SIMD_X86
+    if constexpr (is_simd_weight<Weight>()) {
+        static const int level = simd_level();
+        if (level == SIMD_AVX512) {
+            return min_key_position_avx512(keys, n);
+        } else if (level == SIMD_AVX2) {
+            return min_key_position_avx2(keys, n);
+        }
+    }
+#endif
+    return min_key_position_scalar(keys, n);
+}
+
+const size_t NOT_IN_HEAP = size_t(-1);
+const size_t HEAP_ARITY = 4;
+
+template <typename NodeId, typename Weight>
+class IndexedHeap{
+    public:
+        IndexedHeap(const size_t nodes) : positions(nodes, NOT_IN_HEAP) {}
+        bool empty() {return this->heap_nodes.empty();}
+        bool contains(const NodeId node) {return this->positions[node] != NOT_IN_HEAP;}
+        Weight get_key(const NodeId node) {return this->heap_keys[this->positions[node]];}
+        Weight top_key() {return this->heap_keys[0];}
+        void push_or_decrease(const NodeId node, const Weight key);
+        NodeId pop(); // removes the node with the smallest key and returns it
+    private:
+        void sift_up(size_t position);
+        void sift_down(size_t position);
+        void place(const size_t position, const NodeId node, const Weight key);
+        vector<NodeId> heap_nodes;
+        vector<Weight> heap_keys; // kept side by side, comparisons only touch keys
+        vector<size_t> positions; // position of every node in the heap, NOT_IN_HEAP if absent
+};
+
+template <typename NodeId, typename Weight>
+void IndexedHeap<NodeId, Weight>::place(const size_t position, const NodeId node, const Weight key) {
+    this->heap_nodes[position] = node;
+    this->heap_keys[position] = key;
+    this->positions[node] = position;
+}
+
+template <typename NodeId, typename Weight>
+void IndexedHeap<NodeId, Weight>::push_or_decrease(const NodeId node, const Weight key) {
+    if (!this->contains(node)) {
+        this->heap_nodes.push_back(node);
+        this->heap_keys.push_back(key);
+        this->positions[node] = this->heap_nodes.size() - 1;
+    } else if (key < this->get_key(node)) {
+        this->heap_keys[this->positions[node]] = key;
+    } else {
+        return;
+    }
+    this->sift_up(this->positions[node]);
+}
+
+template <typename NodeId, typename Weight>
+NodeId IndexedHeap<NodeId, Weight>::pop() {
+    const NodeId top = this->heap_nodes[0];
+    this->positions[top] = NOT_IN_HEAP;
+    const NodeId last_node = this->heap_nodes.back();
+    const Weight last_key = this->heap_keys.back();
+    this->heap_nodes.pop_back();
+    this->heap_keys.pop_back();
+    if (!this->heap_nodes.empty()) {
+        this->place(0, last_node, last_key);
+        this->sift_down(0);
+    }
+    return top;
+}
+
+template <typename NodeId, typename Weight>
+void IndexedHeap<NodeId, Weight>::sift_up(size_t position) {
+    const NodeId node = this->heap_nodes[position];
+    const Weight key = this->heap_keys[position];
+    while (position > 0) {
+        const size_t parent = (position - 1) / HEAP_ARITY;
+        if (this->heap_keys[parent] <= key) {
+            break;
+        }
+        this->place(position, this->heap_nodes[parent], this->heap_keys[parent]);
+        position = parent;
+    }
+    this->place(position, node, key);
+}
+
+template <typename NodeId, typename Weight>
+void IndexedHeap<NodeId, Weight>::sift_down(size_t position) {
+    const NodeId node = this->heap_nodes[position];
+    const Weight key = this->heap_keys[position];
+    const size_t size = this->heap_nodes.size();
+    while (true) {
+        // Find the smallest of up to HEAP_ARITY children
+        const size_t first_child = position * HEAP_ARITY + 1;
+        if (first_child >= size) {
+            break;
+        }
+        size_t smallest = first_child;
+        const size_t last_child = min(first_child + HEAP_ARITY, size);
+        for (size_t child = first_child + 1; child < last_child; ++child) {
+            if (this->heap_keys[child] < this->heap_keys[smallest]) {
+                smallest = child;
+            }
+        }
+        if (this->heap_keys[smallest] >= key) {
+            break;
+        }
+        this->place(position, this->heap_nodes[smallest], this->heap_keys[smallest]);
+        position = smallest;
+    }
+    this->place(position, node, key);
+}
+
+template <typename NodeId, typename Weight>
+class Prim{
+    public:
+        Prim(const size_t nodes) : num_of_nodes(nodes) {}
+        void build(const EdgeList<NodeId, Weight>& edges, SpanningTree<NodeId, Weight>& mst);
+    private:
+        void build_adjacency(const EdgeList<NodeId, Weight>& edges);
+        void build_dense(SpanningTree<NodeId, Weight>& mst);
+        size_t num_of_nodes;
+        vector<size_t> offsets; // neighbours of node n are in [offsets[n], offsets[n+1])
+        vector<NodeId> neighbours;
+        vector<Weight> neighbour_weights;
+};
+
+template <typename NodeId, typename Weight>
+void Prim<NodeId, Weight>::build_adjacency(const EdgeList<NodeId, Weight>& edges) {
+    // Count degrees, turn them into offsets, then scatter both directions of every edge
+    this->offsets.assign(this->num_of_nodes + 1, 0);
+    for (size_t idx = 0; idx < edges.size(); ++idx) {
+        this->offsets[edges.sources[idx] + 1] ++;
+        this->offsets[edges.destinations[idx] + 1] ++;
+    }
+    for (size_t node = 0; node < this->num_of_nodes; ++node) {
+        this->offsets[node + 1] += this->offsets[node];
+    }
+
+    this->neighbours.resize(2 * edges.size());
+    this->neighbour_weights.resize(2 * edges.size());
+    vector<size_t> cursor(this->offsets.begin(), this->offsets.end() - 1);
+    for (size_t idx = 0; idx < edges.size(); ++idx) {
+        const NodeId source = edges.sources[idx], destination = edges.destinations[idx];
+        this->neighbours[cursor[source]] = destination;
+        this->neighbour_weights[cursor[source]++] = edges.weights[idx];
+        this->neighbours[cursor[destination]] = source;
+        this->neighbour_weights[cursor[destination]++] = edges.weights[idx];
+    }
+}
+
+// Share of all node pairs joined by an edge from which Prim searches a key array instead of keeping a heap
+const double PRIM_DENSE_FILL = 0.25;
+
+template <typename NodeId, typename Weight>
+void Prim<NodeId, Weight>::build(const EdgeList<NodeId, Weight>& edges, SpanningTree<NodeId, Weight>& mst) {
+    const NodeId NO_PARENT = NodeId(-1);
+    this->build_adjacency(edges);
+    if (this->num_of_nodes > 1 && edges.size() >= PRIM_DENSE_FILL * this->num_of_nodes * (this->num_of_nodes - 1) / 2) {
+        this->build_dense(mst);
+        return;
+    }
+
+    IndexedHeap<NodeId, Weight> heap(this->num_of_nodes);
+    vector<NodeId> parent(this->num_of_nodes, NO_PARENT);
+    vector<bool> in_tree(this->num_of_nodes, false);
+
+    // Every node not reached yet starts a new tree, so disconnected graphs give a forest
+    for (size_t root = 0; root < this->num_of_nodes; ++root) {
+        if (in_tree[root]) {
+            continue;
+        }
+        heap.push_or_decrease(NodeId(root), Weight(0));
+        while (!heap.empty()) {
+            const Weight key = heap.top_key();
+            const NodeId node = heap.pop();
+            in_tree[node] = true;
+            if (parent[node] != NO_PARENT) {
+                mst.add_edge(parent[node], node, key);
+            }
+
+            // Relax edges leaving the tree through the new node
+            for (size_t idx = this->offsets[node]; idx < this->offsets[node + 1]; ++idx) {
+                const NodeId neighbour = this->neighbours[idx];
+                const Weight weight = this->neighbour_weights[idx];
+                if (!in_tree[neighbour] && (!heap.contains(neighbour) || weight < heap.get_key(neighbour))) {
+                    heap.push_or_decrease(neighbour, weight);
+                    parent[neighbour] = node;
+                }
+            }
+        }
+    }
+}
+
+// O(V^2) Prim, every step searches the keys of all nodes outside the tree with min_key_position
+// Nodes outside the tree are kept packed at the front, a taken node is replaced by the last one, so searches shrink step by step
+template <typename NodeId, typename Weight>
+void Prim<NodeId, Weight>::build_dense(SpanningTree<NodeId, Weight>& mst) {
+    const NodeId NO_PARENT = NodeId(-1);
+    const size_t TAKEN = size_t(-1);
+    const Weight UNREACHED = numeric_limits<Weight>::has_infinity ? numeric_limits<Weight>::infinity() : numeric_limits<Weight>::max();
+    vector<Weight> keys(this->num_of_nodes, UNREACHED);
+    vector<NodeId> remaining(this->num_of_nodes), parent(this->num_of_nodes, NO_PARENT);
+    vector<size_t> slots(this->num_of_nodes); // place of every node in remaining and keys, TAKEN once in the tree
+    iota(remaining.begin(), remaining.end(), NodeId(0));
+    iota(slots.begin(), slots.end(), size_t(0));
+
+    for (size_t num_of_remaining = this->num_of_nodes; num_of_remaining > 0; --num_of_remaining) {
+        size_t position = min_key_position(keys.data(), num_of_remaining);
+        if (parent[remaining[position]] == NO_PARENT && keys[position] == UNREACHED) {
+            // Either the tree is complete and a new one starts here, or a reached node has an edge as heavy as UNREACHED
+            for (size_t idx = 0; idx < num_of_remaining; ++idx) {
+                if (parent[remaining[idx]] != NO_PARENT) {
+                    position = idx;
+                    break;
+                }
+            }
+        }
+        const NodeId node = remaining[position];
+        if (parent[node] != NO_PARENT) {
+            mst.add_edge(parent[node], node, keys[position]);
+        }
+        remaining[position] = remaining[num_of_remaining - 1];
+        keys[position] = keys[num_of_remaining - 1];
+        slots[remaining[position]] = position;
+        slots[node] = TAKEN;
+
+        for (size_t idx = this->offsets[node]; idx < this->offsets[node + 1]; ++idx) {
+            const NodeId neighbour = this->neighbours[idx];
+            const size_t slot = slots[neighbour];
+            if (slot != TAKEN && (parent[neighbour] == NO_PARENT || this->neighbour_weights[idx] < keys[slot])) {
+                keys[slot] = this->neighbour_weights[idx];
+                parent[neighbour] = node;
+            }
+        }
+    }
+}
+
+// O(V^2) Prim over a complete graph without any edge list, only O(V) keys and node ids are kept
+// read_weights(node, targets, count, weights) gives the weights of the edges from node to targets[0, count),
+// it is called once for every node when it joins the tree, for the nodes still outside the tree
+// so a weight matrix is read one row at a time and a distance callback is evaluated for about V^2/2 pairs
+template <typename NodeId, typename Weight, typename ReadWeights>
+void compute_dense_mst(const size_t num_of_nodes, ReadWeights read_weights, MstResult<NodeId, Weight>& result) {
+    result.edges.clear();
+    result.cost = 0;
+    if (num_of_nodes == 0) {
+        return;
+    }
+    result.edges.reserve(num_of_nodes - 1);
+    vector<Weight> keys(num_of_nodes), weights(num_of_nodes);
+    vector<NodeId> remaining(num_of_nodes), parent(num_of_nodes);
+    iota(remaining.begin(), remaining.end(), NodeId(0));
+
+    // Node 0 is the root and the last node takes its place, remaining[0, num_of_remaining) are the nodes outside the tree
+    NodeId node = remaining[0];
+    size_t num_of_remaining = num_of_nodes - 1;
+    remaining[0] = remaining[num_of_remaining];
+    read_weights(node, remaining.data(), num_of_remaining, keys.data());
+    fill(parent.begin(), parent.end(), node);
+    while (num_of_remaining > 0) {
+        const size_t position = min_key_position(keys.data(), num_of_remaining);
+        node = remaining[position];
+        result.edges.emplace_back(parent[position], node, keys[position]);
+        result.cost += keys[position];
+        num_of_remaining --;
+        remaining[position] = remaining[num_of_remaining];
+        keys[position] = keys[num_of_remaining];
+        parent[position] = parent[num_of_remaining];
+
+        // Parents are kept by position like the keys, so relaxing touches three arrays sequentially
+        read_weights(node, remaining.data(), num_of_remaining, weights.data());
+        for (size_t idx = 0; idx < num_of_remaining; ++idx) {
+            if (weights[idx] < keys[idx]) {
+                keys[idx] = weights[idx];
+                parent[idx] = node;
+            }
+        }
+    }
+}
+
+// Text weight matrix, the node size on the first line and then one line for every node
+// holding the weights of its edges to all the nodes, its own entry is ignored
+// Only the start of every row is indexed, a row is decoded from the mapped file when Prim asks for it
+template <typename NodeId, typename Weight>
+class DenseMatrix{
+    public:
+        DenseMatrix(const string path);
+        bool is_open() {return this->is_valid;}
+        size_t get_node_size() {return this->num_of_nodes;}
+        void read_weights(const NodeId node, const NodeId* targets, const size_t count, Weight* weights);
+    private:
+        MappedFile mapped;
+        size_t num_of_nodes;
+        bool is_valid;
+        vector<const char*> rows; // first byte of every row
+        vector<Weight> row;
+};
+
+template <typename NodeId, typename Weight>
+DenseMatrix<NodeId, Weight>::DenseMatrix(const string path) : mapped(path), num_of_nodes(0), is_valid(false) {
+    if (!this->mapped.is_open()) {
+        cerr << "Can not open " << path << endl;
+        return;
+    }
+    const char* cursor = this->mapped.begin();
+    const char* end = this->mapped.end();
+    if (!scan_value(cursor, end, this->num_of_nodes)) {
+        cerr << path << " does not start with the node size" << endl;
+        return;
+    }
+    if (!is_text_large_enough(this->num_of_nodes, this->num_of_nodes, end - cursor)) {
+        cerr << path << " is too short for a matrix of " << this->num_of_nodes << " nodes" << endl;
+        return;
+    }
+    this->rows.reserve(this->num_of_nodes);
+    while (cursor != end && this->rows.size() < this->num_of_nodes) {
+        const char* line_end = static_cast<const char*>(memchr(cursor, '\n', end - cursor));
+        line_end = (line_end != nullptr) ? line_end : end;
+        if (line_end != cursor && find_if(cursor, line_end, [](const char c) {return !isspace((unsigned char)c);}) != line_end) {
+            this->rows.push_back(cursor);
+        }
+        cursor = (line_end != end) ? line_end + 1 : end;
+    }
+    if (this->rows.size() < this->num_of_nodes) {
+        cerr << path << " has " << this->rows.size() << " rows instead of " << this->num_of_nodes << endl;
+        return;
+    }
+    this->row.resize(this->num_of_nodes);
+    this->is_valid = true;
+}
+
+template <typename NodeId, typename Weight>
+void DenseMatrix<NodeId, Weight>::read_weights(const NodeId node, const NodeId* targets, const size_t count, Weight* weights) {
+    // A short row leaves its missing weights at the largest value, so they are never taken
+    const char* cursor = this->rows[node];
+    const char* end = (size_t(node) + 1 < this->num_of_nodes) ? this->rows[node + 1] : this->mapped.end();
+    size_t column = 0;
+    while (column < this->num_of_nodes && scan_value(cursor, end, this->row[column])) {
+        column ++;
+    }
+    if (column < this->num_of_nodes) {
+        LOG_SUMMARY("Row " << node << " holds only " << column << " weights");
+        fill(this->row.begin() + column, this->row.end(), numeric_limits<Weight>::max());
+    }
+    for (size_t idx = 0; idx < count; ++idx) {
+        weights[idx] = this->row[targets[idx]];
+    }
+}
+
+// Edges are scanned and compacted in tasks of this many edges, nodes are relabelled in tasks of this many nodes
+const size_t BORUVKA_TASK_EDGES = 1 << 16;
+const size_t BORUVKA_TASK_NODES = 1 << 14;
+const uint64_t NO_EDGE = ~uint64_t(0);
+
+template <typename NodeId, typename Weight>
+class Boruvka{
+    public:
+        Boruvka(const size_t nodes, const unsigned workers) : num_of_nodes(nodes), num_of_workers(max(1u, workers)) {}
+        void build(const EdgeList<NodeId, Weight>& edges, SpanningTree<NodeId, Weight>& mst);
+    private:
+        void find_lightest_edges(const EdgeList<NodeId, Weight>& edges, vector<atomic<uint64_t>>& lightest);
+        void compact(EdgeList<NodeId, Weight>& edges);
+        bool contract(const EdgeList<NodeId, Weight>& edges, vector<atomic<uint64_t>>& lightest, SpanningTree<NodeId, Weight>& mst);
+        size_t num_of_nodes;
+        unsigned num_of_workers;
+        ConcurrentDisjointSet<NodeId> components;
+        vector<NodeId> labels; // component of every node in the current round
+};
+
+// Weights up to 32 bits are packed into the key next to the edge position, wider ones are read back from the edge list
+template <typename Weight>
+constexpr bool is_boruvka_key_packed() {
+    return sizeof(Weight) <= 4;
+}
+
+// Maps a weight up to 32 bits to an unsigned value which compares in the same order
+template <typename Weight>
+uint32_t boruvka_weight_bits(const Weight weight) {
+    if constexpr (is_floating_point<Weight>::value) {
+        uint32_t bits;
+        memcpy(&bits, &weight, sizeof(bits));
+        return (bits & 0x80000000u) ? ~bits : (bits ^ 0x80000000u); // negative floats order reversed
+    } else if constexpr (is_signed<Weight>::value) {
+        return uint32_t(int32_t(weight)) ^ 0x80000000u;
+    } else {
+        return uint32_t(weight);
+    }
+}
+
+// Packs (weight, edge position) so that comparing keys orders edges by weight and breaks ties by position
+// A strict total order makes both components of an edge agree on it, hence no cycle is ever formed
+template <typename Weight>
+uint64_t boruvka_key(const Weight weight, const size_t position) {
+    if constexpr (is_boruvka_key_packed<Weight>()) {
+        return (uint64_t(boruvka_weight_bits(weight)) << 32) | uint32_t(position);
+    } else {
+        return position;
+    }
+}
+
+template <typename Weight>
+size_t boruvka_position(const uint64_t key) {
+    return is_boruvka_key_packed<Weight>() ? size_t(uint32_t(key)) : size_t(key);
+}
+
+template <typename NodeId, typename Weight>
+void Boruvka<NodeId, Weight>::find_lightest_edges(const EdgeList<NodeId, Weight>& edges, vector<atomic<uint64_t>>& lightest) {
+    // Same order as the packed keys, (weight, position), for keys holding the position only
+    auto is_lighter = [&](const uint64_t key, const uint64_t current) {
+        if constexpr (is_boruvka_key_packed<Weight>()) {
+            return key < current;
+        } else {
+            return current == NO_EDGE || edges.weights[key] < edges.weights[current] ||
+                (edges.weights[key] == edges.weights[current] && key < current);
+        }
+    };
+    const size_t num_of_tasks = (edges.size() + BORUVKA_TASK_EDGES - 1) / BORUVKA_TASK_EDGES;
+    run_tasks(this->num_of_workers, num_of_tasks, [&](const size_t task) {
+        const size_t first = task * BORUVKA_TASK_EDGES, last = min(first + BORUVKA_TASK_EDGES, edges.size());
+        for (size_t position = first; position < last; ++position) {
+            // Self-loops of the input are inside a single component from the start, they must never be its lightest edge
+            const NodeId source_component = this->labels[edges.sources[position]], destination_component = this->labels[edges.destinations[position]];
+            if (source_component == destination_component) {
+                continue;
+            }
+            const uint64_t key = boruvka_key(edges.weights[position], position);
+            for (const NodeId component : {source_component, destination_component}) {
+                uint64_t current = lightest[component].load(memory_order_relaxed);
+                while (is_lighter(key, current) && !lightest[component].compare_exchange_weak(current, key, memory_order_relaxed)) {
+                }
+            }
+        }
+    });
+}
+
+template <typename NodeId, typename Weight>
+void Boruvka<NodeId, Weight>::compact(EdgeList<NodeId, Weight>& edges) {
+    // Every task counts its surviving edges, prefix sums give the place of each task in the new list
+    const size_t num_of_tasks = (edges.size() + BORUVKA_TASK_EDGES - 1) / BORUVKA_TASK_EDGES;
+    vector<size_t> kept(num_of_tasks + 1, 0);
+    auto is_kept = [&](const size_t position) {
+        return this->labels[edges.sources[position]] != this->labels[edges.destinations[position]];
+    };
+    run_tasks(this->num_of_workers, num_of_tasks, [&](const size_t task) {
+        const size_t first = task * BORUVKA_TASK_EDGES, last = min(first + BORUVKA_TASK_EDGES, edges.size());
+        for (size_t position = first; position < last; ++position) {
+            kept[task + 1] += is_kept(position);
+        }
+    });
+    for (size_t task = 0; task < num_of_tasks; ++task) {
+        kept[task + 1] += kept[task];
+    }
+
+    EdgeList<NodeId, Weight> survivors;
+    survivors.sources.resize(kept[num_of_tasks]);
+    survivors.destinations.resize(kept[num_of_tasks]);
+    survivors.weights.resize(kept[num_of_tasks]);
+    drop_pages(survivors.sources.data(), survivors.size() * sizeof(NodeId));
+    drop_pages(survivors.destinations.data(), survivors.size() * sizeof(NodeId));
+    drop_pages(survivors.weights.data(), survivors.size() * sizeof(Weight));
+    run_tasks(this->num_of_workers, num_of_tasks, [&](const size_t task) {
+        const size_t first = task * BORUVKA_TASK_EDGES, last = min(first + BORUVKA_TASK_EDGES, edges.size());
+        size_t target = kept[task];
+        for (size_t position = first; position < last; ++position) {
+            if (is_kept(position)) {
+                survivors.sources[target] = edges.sources[position];
+                survivors.destinations[target] = edges.destinations[position];
+                survivors.weights[target++] = edges.weights[position];
+            }
+        }
+    });
+    swap(edges, survivors);
+}
+
+template <typename NodeId, typename Weight>
+bool Boruvka<NodeId, Weight>::contract(const EdgeList<NodeId, Weight>& edges, vector<atomic<uint64_t>>& lightest, SpanningTree<NodeId, Weight>& mst) {
+    // Contract every component along its lightest edge, an edge chosen by both of its components is added once
+    // Every task keeps the edges it merged, they are moved to the tree in task order afterwards
+    const size_t num_of_tasks = (this->num_of_nodes + BORUVKA_TASK_NODES - 1) / BORUVKA_TASK_NODES;
+    vector<vector<size_t>> merged(num_of_tasks);
+    run_tasks(this->num_of_workers, num_of_tasks, [&](const size_t task) {
+        const size_t first = task * BORUVKA_TASK_NODES, last = min(first + BORUVKA_TASK_NODES, this->num_of_nodes);
+        for (size_t component = first; component < last; ++component) {
+            const uint64_t key = lightest[component].load(memory_order_relaxed);
+            lightest[component].store(NO_EDGE, memory_order_relaxed); // ready for the next round
+            if (key == NO_EDGE) {
+                continue;
+            }
+            const size_t position = boruvka_position<Weight>(key);
+            if (this->components.unite(edges.sources[position], edges.destinations[position])) {
+                merged[task].push_back(position);
+            }
+        }
+    });
+
+    bool is_merged = false;
+    for (auto &positions : merged) {
+        for (const size_t position : positions) {
+            mst.add_edge(edges.sources[position], edges.destinations[position], edges.weights[position]);
+            is_merged = true;
+        }
+    }
+
+    // Finds run after all unions are done, so every node sees the root of its final component
+    run_tasks(this->num_of_workers, num_of_tasks, [&](const size_t task) {
+        const size_t first = task * BORUVKA_TASK_NODES, last = min(first + BORUVKA_TASK_NODES, this->num_of_nodes);
+        for (size_t node = first; node < last; ++node) {
+            this->labels[node] = this->components.find(NodeId(node));
+        }
+    });
+    return is_merged;
+}
+
+template <typename NodeId, typename Weight>
+void Boruvka<NodeId, Weight>::build(const EdgeList<NodeId, Weight>& input_edges, SpanningTree<NodeId, Weight>& mst) {
+    // Rounds compact their own copy, nodes are initialised in the same tasks which will scan them
+    EdgeList<NodeId, Weight> edges;
+    copy_column(input_edges.sources, edges.sources, this->num_of_workers);
+    copy_column(input_edges.destinations, edges.destinations, this->num_of_workers);
+    copy_column(input_edges.weights, edges.weights, this->num_of_workers);
+    this->components.reset(this->num_of_nodes, this->num_of_workers);
+    vector<atomic<uint64_t>> lightest(this->num_of_nodes);
+    this->labels.resize(this->num_of_nodes);
+    drop_pages(lightest.data(), this->num_of_nodes * sizeof(atomic<uint64_t>));
+    drop_pages(this->labels.data(), this->num_of_nodes * sizeof(NodeId));
+    const size_t num_of_tasks = (this->num_of_nodes + BORUVKA_TASK_NODES - 1) / BORUVKA_TASK_NODES;
+    run_tasks(this->num_of_workers, num_of_tasks, [&](const size_t task) {
+        const size_t first = task * BORUVKA_TASK_NODES, last = min(first + BORUVKA_TASK_NODES, this->num_of_nodes);
+        for (size_t node = first; node < last; ++node) {
+            this->labels[node] = NodeId(node);
+            lightest[node].store(NO_EDGE, memory_order_relaxed);
+        }
+    });
+
+    bool is_merged = true;
+    while (is_merged && edges.size() > 0) {
+        this->find_lightest_edges(edges, lightest);
+        is_merged = this->contract(edges, lightest, mst);
+        this->compact(edges);
+    }
+}
+
+// Points of a Euclidean input, coordinates of point p are coordinates[p * dimensions, (p + 1) * dimensions)
+struct PointSet{
+    size_t num_of_points = 0, dimensions = 0;
+    vector<double> coordinates;
+};
+
+// Reads "num_of_points dimensions" followed by the coordinates of every point
+bool load_points(const string points_file, PointSet& points) {
+    MappedFile mapped(points_file);
+    if (!mapped.is_open()) {
+        cerr << "Can not open " << points_file << endl;
+        return false;
+    }
+    const char* cursor = mapped.begin();
+    if (!scan_value(cursor, mapped.end(), points.num_of_points) || !scan_value(cursor, mapped.end(), points.dimensions) || points.dimensions == 0) {
+        cerr << points_file << " does not start with the number of points and dimensions" << endl;
+        return false;
+    }
+    if (!is_text_large_enough(points.num_of_points, points.dimensions, mapped.end() - cursor)) {
+        cerr << points_file << " is too short for " << points.num_of_points << " points of " << points.dimensions << " dimensions" << endl;
+        return false;
+    }
+    points.coordinates.resize(points.num_of_points * points.dimensions);
+    for (size_t idx = 0; idx < points.coordinates.size(); ++idx) {
+        if (!scan_value(cursor, mapped.end(), points.coordinates[idx])) {
+            cerr << "Point " << idx / points.dimensions << " of " << points_file << " is truncated" << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+double squared_distance(const double* a, const double* b, const size_t dimensions) {
+    double sum = 0;
+    for (size_t dimension = 0; dimension < dimensions; ++dimension) {
+        sum += (a[dimension] - b[dimension]) * (a[dimension] - b[dimension]);
+    }
+    return sum;
+}
+
+const size_t KD_LEAF_POINTS = 16;
+
+// Euclidean minimum spanning tree of a point set without materialising the O(n^2) pairs
+// Boruvka rounds over a k-d tree, in every round each point looks for its nearest point in another component
+// Subtrees lying entirely in the component of the query are skipped, and so are boxes farther than the best edge
+// its component has found so far, so late rounds with few big components stay cheap
+template <typename NodeId, typename Weight>
+class EuclideanBoruvka{
+    public:
+        void build(const PointSet& points, SpanningTree<NodeId, Weight>& mst);
+    private:
+        struct KdNode{
+            size_t first, last; // points of the node in tree order
+            size_t left, right; // children, 0 for a leaf
+            size_t component; // shared component of all the points, MIXED if they differ
+        };
+        // Candidate edge of a component, (squared distance, smaller and larger tree position) orders ties strictly
+        struct Candidate{
+            double distance = numeric_limits<double>::infinity();
+            size_t a = 0, b = 0;
+            bool is_better(const double d, size_t p, size_t q) const;
+        };
+        size_t build_tree(const size_t first, const size_t last);
+        void update_components();
+        void find_nearest(const size_t query, Candidate& best);
+        const double* coordinates_of(const size_t position) {return this->coordinates.data() + position * this->dimensions;}
+        static constexpr size_t MIXED = size_t(-1);
+        size_t dimensions;
+        vector<double> coordinates; // reordered so that every node covers a contiguous range
+        vector<size_t> point_ids; // input position of every point in tree order
+        vector<KdNode> nodes;
+        vector<double> box_min, box_max; // bounding box of node n at n * dimensions
+        vector<size_t> components; // component root of every point in tree order
+        vector<size_t> stack;
+};
+
+template <typename NodeId, typename Weight>
+bool EuclideanBoruvka<NodeId, Weight>::Candidate::is_better(const double d, size_t p, size_t q) const {
+    if (p > q) {
+        swap(p, q);
+    }
+    return d < this->distance || (d == this->distance && (p < this->a || (p == this->a && q < this->b)));
+}
+
+template <typename NodeId, typename Weight>
+size_t EuclideanBoruvka<NodeId, Weight>::build_tree(const size_t first, const size_t last) {
+    const size_t node = this->nodes.size();
+    this->nodes.push_back(KdNode{first, last, 0, 0, MIXED});
+    this->box_min.resize(this->nodes.size() * this->dimensions, numeric_limits<double>::infinity());
+    this->box_max.resize(this->nodes.size() * this->dimensions, -numeric_limits<double>::infinity());
+    double* low = this->box_min.data() + node * this->dimensions;
+    double* high = this->box_max.data() + node * this->dimensions;
+    for (size_t idx = first; idx < last; ++idx) {
+        for (size_t dimension = 0; dimension < this->dimensions; ++dimension) {
+            low[dimension] = min(low[dimension], this->coordinates[this->point_ids[idx] * this->dimensions + dimension]);
+            high[dimension] = max(high[dimension], this->coordinates[this->point_ids[idx] * this->dimensions + dimension]);
+        }
+    }
+    if (last - first <= KD_LEAF_POINTS) {
+        return node;
+    }
+
+    // Split the widest side of the box at the median point
+    size_t split = 0;
+    for (size_t dimension = 1; dimension < this->dimensions; ++dimension) {
+        if (high[dimension] - low[dimension] > high[split] - low[split]) {
+            split = dimension;
+        }
+    }
+    const size_t middle = first + (last - first) / 2;
+    nth_element(this->point_ids.begin() + first, this->point_ids.begin() + middle, this->point_ids.begin() + last, [&](const size_t a, const size_t b) {
+        return this->coordinates[a * this->dimensions + split] < this->coordinates[b * this->dimensions + split];
+    });
+    const size_t left = this->build_tree(first, middle);
+    const size_t right = this->build_tree(middle, last);
+    this->nodes[node].left = left;
+    this->nodes[node].right = right;
+    return node;
+}
+
+template <typename NodeId, typename Weight>
+void EuclideanBoruvka<NodeId, Weight>::update_components() {
+    // Children are created after their parent, so walking the nodes backwards visits children first
+    for (size_t idx = this->nodes.size(); idx-- > 0;) {
+        KdNode &kd_node = this->nodes[idx];
+        if (kd_node.left == 0) {
+            kd_node.component = this->components[kd_node.first];
+            for (size_t position = kd_node.first + 1; position < kd_node.last && kd_node.component != MIXED; ++position) {
+                kd_node.component = (this->components[position] == kd_node.component) ? kd_node.component : MIXED;
+            }
+        } else {
+            const size_t left = this->nodes[kd_node.left].component;
+            kd_node.component = (left == this->nodes[kd_node.right].component) ? left : MIXED;
+        }
+    }
+}
+
+template <typename NodeId, typename Weight>
+void EuclideanBoruvka<NodeId, Weight>::find_nearest(const size_t query, Candidate& best) {
+    const double* point = this->coordinates_of(query);
+    const size_t component = this->components[query];
+    auto box_distance = [&](const size_t node) {
+        const double* low = this->box_min.data() + node * this->dimensions;
+        const double* high = this->box_max.data() + node * this->dimensions;
+        double sum = 0;
+        for (size_t dimension = 0; dimension < this->dimensions; ++dimension) {
+            const double gap = max(0.0, max(low[dimension] - point[dimension], point[dimension] - high[dimension]));
+            sum += gap * gap;
+        }
+        return sum;
+    };
+
+    this->stack.assign(1, 0);
+    while (!this->stack.empty()) {
+        const KdNode &node = this->nodes[this->stack.back()];
+        this->stack.pop_back();
+        if (node.component == component || box_distance(&node - this->nodes.data()) > best.distance) {
+            continue;
+        }
+        if (node.left == 0) {
+            for (size_t position = node.first; position < node.last; ++position) {
+                if (this->components[position] != component) {
+                    const double distance = squared_distance(point, this->coordinates_of(position), this->dimensions);
+                    if (best.is_better(distance, query, position)) {
+                        best.distance = distance;
+                        best.a = min(query, position);
+                        best.b = max(query, position);
+                    }
+                }
+            }
+            continue;
+        }
+        // The nearer child is popped first, so its candidates prune the farther one
+        const bool is_left_nearer = box_distance(node.left) <= box_distance(node.right);
+        this->stack.push_back(is_left_nearer ? node.right : node.left);
+        this->stack.push_back(is_left_nearer ? node.left : node.right);
+    }
+}
+
+template <typename NodeId, typename Weight>
+void EuclideanBoruvka<NodeId, Weight>::build(const PointSet& points, SpanningTree<NodeId, Weight>& mst) {
+    const size_t n = points.num_of_points;
+    if (n == 0) {
+        return;
+    }
+    this->dimensions = points.dimensions;
+    this->coordinates = points.coordinates;
+    this->point_ids.resize(n);
+    iota(this->point_ids.begin(), this->point_ids.end(), size_t(0));
+    this->nodes.clear();
+    this->box_min.clear();
+    this->box_max.clear();
+    this->build_tree(0, n);
+    for (size_t position = 0; position < n; ++position) {
+        memcpy(this->coordinates.data() + position * this->dimensions, points.coordinates.data() + this->point_ids[position] * this->dimensions, this->dimensions * sizeof(double));
+    }
+
+    mst.reserve(n - 1);
+    DisjointSet<NodeId> forest(n);
+    this->components.resize(n);
+    iota(this->components.begin(), this->components.end(), size_t(0));
+    vector<Candidate> candidates(n);
+    size_t num_of_tree_edges = 0;
+    while (num_of_tree_edges + 1 < n) {
+        this->update_components();
+        for (size_t position = 0; position < n; ++position) {
+            this->find_nearest(position, candidates[this->components[position]]);
+        }
+
+        // Every component adds its nearest edge, one picked by both of its components is added once
+        for (size_t position = 0; position < n; ++position) {
+            Candidate &candidate = candidates[position];
+            if (candidate.distance != numeric_limits<double>::infinity() && forest.unite(NodeId(candidate.a), NodeId(candidate.b))) {
+                mst.add_edge(NodeId(this->point_ids[candidate.a]), NodeId(this->point_ids[candidate.b]), Weight(sqrt(candidate.distance)));
+                num_of_tree_edges ++;
+            }
+            candidate = Candidate();
+        }
+        for (size_t position = 0; position < n; ++position) {
+            this->components[position] = forest.find(NodeId(position));
+        }
+    }
+}
+
+// Edge record of the on-disk runs
+template <typename NodeId, typename Weight>
+struct PackedEdge{
+    Weight weight;
+    NodeId source, destination;
+};
+
+template <typename NodeId, typename Weight>
+bool operator<(const PackedEdge<NodeId, Weight>& a, const PackedEdge<NodeId, Weight>& b) {
+    return a.weight < b.weight;
+}
+
+// Reads the edges of a text or binary input file block by block, never holding more than one block in memory
+template <typename NodeId, typename Weight>
+class EdgeStream{
+    public:
+        EdgeStream(const string path, const size_t block_bytes);
+        ~EdgeStream() {if (this->fd >= 0) close(this->fd);}
+        EdgeStream(const EdgeStream&) = delete;
+        EdgeStream& operator=(const EdgeStream&) = delete;
+        bool is_open() {return this->fd >= 0;}
+        bool has_failed() {return this->is_failed;}
+        size_t get_node_size() {return this->num_of_nodes;}
+        size_t read_edges(vector<PackedEdge<NodeId, Weight>>& out, const size_t max_edges); // appends up to max_edges, 0 at the end or on an error
+    private:
+        bool refill();
+        template <typename T>
+        bool read_column(vector<T>& column, const int field, const size_t count);
+        int fd;
+        size_t num_of_nodes;
+        bool is_binary, is_finished, is_failed, is_at_end;
+        // Text input : pending bytes, cursor is the next byte to parse, lines before complete_end are whole
+        // Once is_at_end, the whole file has been read and complete_end also covers a last line without newline
+        vector<char> pending;
+        size_t cursor, complete_end, pending_end;
+        // Binary input : file offsets of the three columns and the number of edges left
+        // Columns are read column_edges at a time
+        uint64_t column_offsets[3], next_edge, num_of_edges;
+        size_t column_edges;
+        vector<NodeId> id_column;
+        vector<Weight> weight_column;
+};
+
+template <typename NodeId, typename Weight>
+EdgeStream<NodeId, Weight>::EdgeStream(const string path, const size_t block_bytes)
+    : fd(open(path.c_str(), O_RDONLY)), num_of_nodes(0), is_binary(false), is_finished(false), is_failed(false), is_at_end(false),
+      cursor(0), complete_end(0), pending_end(0), next_edge(0), num_of_edges(0), column_edges(0) {
+    if (this->fd < 0) {
+        return;
+    }
+    posix_fadvise(this->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    BinaryGraphHeader header;
+    if (pread(this->fd, &header, sizeof(header), 0) == ssize_t(sizeof(header)) && is_binary_graph(reinterpret_cast<const char*>(&header), reinterpret_cast<const char*>(&header + 1))) {
+        struct stat info;
+        if (!is_binary_layout_supported<NodeId, Weight>(header)) {
+            close(this->fd);
+            this->fd = -1;
+            return;
+        }
+        if (fstat(this->fd, &info) != 0 || !is_binary_graph_complete(header, info.st_size)) {
+            cerr << "Binary graph is truncated, expected " << header.num_of_edges << " edges" << endl;
+            close(this->fd);
+            this->fd = -1;
+            return;
+        }
+        this->is_binary = true;
+        this->num_of_nodes = header.num_of_nodes;
+        this->num_of_edges = header.num_of_edges;
+        const size_t id_bytes = binary_array_size(header.num_of_edges, sizeof(NodeId));
+        this->column_offsets[0] = sizeof(header);
+        this->column_offsets[1] = sizeof(header) + id_bytes;
+        this->column_offsets[2] = sizeof(header) + 2 * id_bytes;
+        // The id column is read twice, sources then destinations, so the two buffers together stay within the block
+        this->column_edges = max<size_t>(1, block_bytes / (sizeof(NodeId) + sizeof(Weight)));
+        return;
+    }
+
+    // Text input starts with the node size of the graph
+    this->pending.resize(max<size_t>(block_bytes, 4096));
+    this->refill();
+    const char* position = this->pending.data();
+    NodeId nodes;
+    bool is_scanned = scan_value(position, this->pending.data() + this->complete_end, nodes);
+    // Until its first newline or the end of the file, the header line is not complete yet
+    while (!is_scanned && position == this->pending.data() + this->complete_end && !this->is_at_end) {
+        this->refill();
+        position = this->pending.data();
+        is_scanned = scan_value(position, this->pending.data() + this->complete_end, nodes);
+    }
+    if (is_scanned) {
+        this->num_of_nodes = nodes;
+    }
+    this->cursor = position - this->pending.data();
+}
+
+template <typename NodeId, typename Weight>
+bool EdgeStream<NodeId, Weight>::refill() {
+    // Move the unparsed tail to the front and read the next block behind it
+    const size_t tail = this->pending_end - this->cursor;
+    memmove(this->pending.data(), this->pending.data() + this->cursor, tail);
+    this->cursor = 0;
+    this->pending_end = tail;
+    if (tail == this->pending.size()) {
+        this->pending.resize(2 * this->pending.size()); // a single line longer than the block
+    }
+
+    const ssize_t bytes = read(this->fd, this->pending.data() + tail, this->pending.size() - tail);
+    if (bytes <= 0) {
+        this->complete_end = this->pending_end; // the last line may have no newline
+        this->is_at_end = true;
+        return false;
+    }
+    this->pending_end += bytes;
+
+    // Only whole lines are parsed, the partial last line waits for the next block
+    size_t last_newline = this->pending_end;
+    while (last_newline > 0 && this->pending[last_newline - 1] != '\n') {
+        --last_newline;
+    }
+    this->complete_end = last_newline;
+    return true;
+}
+
+template <typename NodeId, typename Weight>
+template <typename T>
+bool EdgeStream<NodeId, Weight>::read_column(vector<T>& column, const int field, const size_t count) {
+    column.resize(count);
+    const ssize_t expected = count * sizeof(T);
+    return pread(this->fd, column.data(), expected, this->column_offsets[field] + this->next_edge * sizeof(T)) == expected;
+}
+
+template <typename NodeId, typename Weight>
+size_t EdgeStream<NodeId, Weight>::read_edges(vector<PackedEdge<NodeId, Weight>>& out, const size_t max_edges) {
+    size_t count = 0;
+    if (this->is_binary) {
+        const size_t wanted = min<uint64_t>(min(max_edges, this->column_edges), this->num_of_edges - this->next_edge);
+        const size_t first = out.size();
+        out.resize(first + wanted);
+        for (int field = 0; field < 3; ++field) {
+            const bool is_read = (field < 2) ? this->read_column(this->id_column, field, wanted) : this->read_column(this->weight_column, field, wanted);
+            if (!is_read) {
+                cerr << "Binary graph is truncated" << endl;
+                out.resize(first);
+                this->next_edge = this->num_of_edges;
+                this->is_failed = true;
+                return 0;
+            }
+            for (size_t idx = 0; idx < wanted; ++idx) {
+                if (field < 2 && this->id_column[idx] >= this->num_of_nodes) {
+                    cerr << "Edge " << this->next_edge + idx << " refers to node " << this->id_column[idx] << ", outside of the " << this->num_of_nodes << " nodes of the graph" << endl;
+                    out.resize(first);
+                    this->next_edge = this->num_of_edges;
+                    this->is_failed = true;
+                    return 0;
+                }
+                if (field == 0) {
+                    out[first + idx].source = this->id_column[idx];
+                } else if (field == 1) {
+                    out[first + idx].destination = this->id_column[idx];
+                } else {
+                    out[first + idx].weight = this->weight_column[idx];
+                }
+            }
+        }
+        this->next_edge += wanted;
+        return wanted;
+    }
+
+    while (count < max_edges && !this->is_finished) {
+        const char* position = this->pending.data() + this->cursor;
+        const char* end = this->pending.data() + this->complete_end;
+        const char* edge_begin = position;
+        PackedEdge<NodeId, Weight> edge;
+        while (count < max_edges && scan_value(position, end, edge.source) && scan_value(position, end, edge.destination) && scan_value(position, end, edge.weight)) {
+            edge_begin = position;
+            if (!is_edge_in_range(edge.source, edge.destination, this->num_of_nodes)) {
+                this->is_finished = this->is_failed = true;
+                return 0;
+            }
+            out.push_back(edge);
+            ++count;
+        }
+        if (count == max_edges) {
+            this->cursor = position - this->pending.data();
+            break;
+        }
+        if (position != end) {
+            this->is_finished = this->is_failed = true;
+            report_malformed_edge(position, end);
+            return 0;
+        }
+        // An edge split over lines waits for the rest of it, the file may only end after whole edges
+        const char* rest = edge_begin;
+        NodeId token;
+        const bool is_partial = scan_value(rest, end, token);
+        if (is_partial && this->is_at_end) {
+            this->is_finished = this->is_failed = true;
+            report_malformed_edge(end, end);
+            return 0;
+        }
+        this->cursor = is_partial ? edge_begin - this->pending.data() : this->complete_end;
+        if (this->is_at_end) {
+            this->is_finished = true;
+        } else {
+            this->refill();
+        }
+    }
+    return count;
+}
+
+// Sorted run on disk, read back one block at a time
+template <typename NodeId, typename Weight>
+class RunReader{
+    public:
+        RunReader(const int file, const size_t edges, const size_t block_edges)
+            : fd(file), remaining(edges), offset(0), position(0), block(block_edges) {block.clear();}
+        bool next(PackedEdge<NodeId, Weight>& edge);
+    private:
+        int fd;
+        size_t remaining, offset, position;
+        vector<PackedEdge<NodeId, Weight>> block;
+};
+
+template <typename NodeId, typename Weight>
+bool RunReader<NodeId, Weight>::next(PackedEdge<NodeId, Weight>& edge) {
+    if (this->position == this->block.size()) {
+        if (this->remaining == 0) {
+            return false;
+        }
+        const size_t count = min(this->remaining, this->block.capacity());
+        this->block.resize(count);
+        const ssize_t bytes = count * sizeof(PackedEdge<NodeId, Weight>);
+        if (pread(this->fd, this->block.data(), bytes, this->offset) != bytes) {
+            cerr << "Can not read back a sorted run" << endl;
+            this->remaining = 0;
+            return false;
+        }
+        this->offset += bytes;
+        this->remaining -= count;
+        this->position = 0;
+    }
+    edge = this->block[this->position++];
+    return true;
+}
+
+// Memory budget used when nothing else is given, in bytes
+const size_t DEFAULT_MEMORY_BUDGET = size_t(1) << 30;
+
+template <typename NodeId, typename Weight>
+class ExternalKruskal{
+    public:
+        ExternalKruskal(const size_t budget, const string directory) : memory_budget(budget), temp_directory(directory), num_of_nodes(0) {}
+        ~ExternalKruskal();
+        bool build(const string input_file, SpanningTree<NodeId, Weight>& mst);
+        size_t get_node_size() {return this->num_of_nodes;}
+    private:
+        typedef PackedEdge<NodeId, Weight> Record;
+        bool write_run(vector<Record>& run);
+        void merge_runs(SpanningTree<NodeId, Weight>& mst);
+        void scan(vector<Record>& run, SpanningTree<NodeId, Weight>& mst);
+        bool accept(const Record& edge, SpanningTree<NodeId, Weight>& mst);
+        size_t memory_budget;
+        string temp_directory;
+        size_t num_of_nodes, num_of_tree_edges;
+        DisjointSet<NodeId> components;
+        vector<int> run_files;
+        vector<size_t> run_sizes;
+};
+
+template <typename NodeId, typename Weight>
+ExternalKruskal<NodeId, Weight>::~ExternalKruskal() {
+    for (const int file : this->run_files) {
+        close(file);
+    }
+}
+
+template <typename NodeId, typename Weight>
+bool ExternalKruskal<NodeId, Weight>::write_run(vector<Record>& run) {
+    stable_sort(run.begin(), run.end());
+
+    // Runs are unlinked right away, the space is given back once the descriptor is closed
+    string path = this->temp_directory + "/mst_run_XXXXXX";
+    const int file = mkstemp(&path[0]);
+    if (file < 0) {
+        cerr << "Can not create a run file in " << this->temp_directory << endl;
+        return false;
+    }
+    unlink(path.c_str());
+
+    const char* data = reinterpret_cast<const char*>(run.data());
+    size_t written = 0, bytes = run.size() * sizeof(Record);
+    while (written < bytes) {
+        const ssize_t count = write(file, data + written, bytes - written);
+        if (count <= 0) {
+            cerr << "Can not write a run file in " << this->temp_directory << endl;
+            close(file);
+            return false;
+        }
+        written += count;
+    }
+    this->run_files.push_back(file);
+    this->run_sizes.push_back(run.size());
+    run.clear();
+    return true;
+}
+
+template <typename NodeId, typename Weight>
+bool ExternalKruskal<NodeId, Weight>::accept(const Record& edge, SpanningTree<NodeId, Weight>& mst) {
+    if (this->components.unite(edge.source, edge.destination)) {
+        mst.add_edge(edge.source, edge.destination, edge.weight);
+        this->num_of_tree_edges ++;
+    }
+    return this->num_of_tree_edges + 1 < this->num_of_nodes;
+}
+
+template <typename NodeId, typename Weight>
+void ExternalKruskal<NodeId, Weight>::scan(vector<Record>& run, SpanningTree<NodeId, Weight>& mst) {
+    stable_sort(run.begin(), run.end());
+    for (auto &edge : run) {
+        if (!this->accept(edge, mst)) {
+            return;
+        }
+    }
+}
+
+template <typename NodeId, typename Weight>
+void ExternalKruskal<NodeId, Weight>::merge_runs(SpanningTree<NodeId, Weight>& mst) {
+    // Budget is shared by the read buffers of all the runs
+    const size_t block_edges = max<size_t>(1, this->memory_budget / (this->run_files.size() * sizeof(Record)));
+    vector<RunReader<NodeId, Weight>> readers;
+    for (size_t run = 0; run < this->run_files.size(); ++run) {
+        readers.push_back(RunReader<NodeId, Weight>(this->run_files[run], this->run_sizes[run], block_edges));
+    }
+
+    // Min-heap of the head edge of every run, ties are taken in run order as in a single sorted list
+    typedef pair<pair<Weight,size_t>, Record> Head;
+    auto is_heavier = [](const Head& a, const Head& b) {return a.first > b.first;};
+    priority_queue<Head, vector<Head>, decltype(is_heavier)> heads(is_heavier);
+    Record edge;
+    for (size_t run = 0; run < readers.size(); ++run) {
+        if (readers[run].next(edge)) {
+            heads.push(make_pair(make_pair(edge.weight, run), edge));
+        }
+    }
+
+    while (!heads.empty()) {
+        const size_t run = heads.top().first.second;
+        if (!this->accept(heads.top().second, mst)) {
+            return;
+        }
+        heads.pop();
+        if (readers[run].next(edge)) {
+            heads.push(make_pair(make_pair(edge.weight, run), edge));
+        }
+    }
+}
+
+template <typename NodeId, typename Weight>
+bool ExternalKruskal<NodeId, Weight>::build(const string input_file, SpanningTree<NodeId, Weight>& mst) {
+    // A third of the budget holds the run being filled, a third the merge buffer of stable_sort when the run is sorted
+    // and a third the input block or the binary column buffers
+    const size_t run_edges = max<size_t>(1, this->memory_budget / 3 / sizeof(Record));
+    vector<Record> run;
+    {
+        // The input block is given back at the end of this scope, before the run readers take the whole budget
+        EdgeStream<NodeId, Weight> input(input_file, this->memory_budget / 3);
+        if (!input.is_open()) {
+            cerr << "Can not open " << input_file << endl;
+            return false;
+        }
+        this->num_of_nodes = input.get_node_size();
+        this->num_of_tree_edges = 0;
+        this->components.reset(this->num_of_nodes);
+        // Growing the tree by doubling would briefly hold two copies of it next to the run readers
+        mst.reserve(this->num_of_nodes > 0 ? this->num_of_nodes - 1 : 0);
+
+        run.reserve(run_edges);
+        while (input.read_edges(run, run_edges - run.size()) > 0) {
+            if (run.size() == run_edges) {
+                if (!this->write_run(run)) {
+                    return false;
+                }
+            }
+        }
+        if (input.has_failed()) {
+            return false;
+        }
+    }
+
+    // Everything fit into a single run, no need to go through the disk
+    if (this->run_files.empty()) {
+        this->scan(run, mst);
+        return true;
+    }
+    if (!run.empty() && !this->write_run(run)) {
+        return false;
+    }
+    vector<Record>().swap(run);
+    LOG_SUMMARY("Merging " << this->run_files.size() << " sorted runs");
+    this->merge_runs(mst);
+    return true;
+}
+
+template <typename NodeId, typename Weight>
+class DynamicSpanningTree{
+    public:
+        DynamicSpanningTree(const size_t nodes);
+        bool insert_new_edge(const NodeId s, const NodeId d, const Weight w); // false for a node outside of the tree
+        void export_tree(SpanningTree<NodeId, Weight>& mst);
+        Cost<Weight> get_cost() {return this->mst_cost;}
+    private:
+        // Link-cut tree primitives, node 0 is the null node
+        bool is_splay_root(const NodeId x);
+        void push_down(const NodeId x);
+        void update(const NodeId x);
+        void rotate(const NodeId x);
+        void splay(const NodeId x);
+        void access(const NodeId x);
+        void make_root(const NodeId x);
+        NodeId find_root(NodeId x);
+        void link(const NodeId x, const NodeId y);
+        void cut(const NodeId x, const NodeId y);
+        NodeId vertex(const NodeId node) {return node + 1;}
+        size_t num_of_nodes;
+        Cost<Weight> mst_cost;
+        vector<NodeId> child[2], parent, max_node; // max_node : node holding the largest value in the splay subtree
+        vector<Weight> value;
+        vector<bool> reversed;
+        vector<Edge<NodeId, Weight>> tree_edges; // edge stored at every edge node
+        vector<NodeId> free_edge_nodes;
+        vector<NodeId> splay_path;
+};
+
+template <typename NodeId, typename Weight>
+DynamicSpanningTree<NodeId, Weight>::DynamicSpanningTree(const size_t nodes) : num_of_nodes(nodes), mst_cost(0) {
+    // Vertices are 1..nodes, a forest has at most nodes-1 edges, which take the following ids
+    const size_t total = 2 * nodes + 1;
+    this->child[0].assign(total, 0);
+    this->child[1].assign(total, 0);
+    this->parent.assign(total, 0);
+    this->value.assign(total, numeric_limits<Weight>::lowest()); // vertices never win a maximum
+    this->max_node.resize(total);
+    this->reversed.assign(total, false);
+    this->tree_edges.resize(total);
+    for (size_t x = 0; x < total; ++x) {
+        this->max_node[x] = NodeId(x);
+    }
+    for (size_t x = total - 1; x > nodes; --x) {
+        this->free_edge_nodes.push_back(NodeId(x));
+    }
+}
+
+template <typename NodeId, typename Weight>
+bool DynamicSpanningTree<NodeId, Weight>::is_splay_root(const NodeId x) {
+    const NodeId p = this->parent[x];
+    return p == 0 || (this->child[0][p] != x && this->child[1][p] != x);
+}
+
+template <typename NodeId, typename Weight>
+void DynamicSpanningTree<NodeId, Weight>::push_down(const NodeId x) {
+    if (this->reversed[x]) {
+        swap(this->child[0][x], this->child[1][x]);
+        for (int side = 0; side < 2; ++side) {
+            if (this->child[side][x]) {
+                this->reversed[this->child[side][x]] = !this->reversed[this->child[side][x]];
+            }
+        }
+        this->reversed[x] = false;
+    }
+}
+
+template <typename NodeId, typename Weight>
+void DynamicSpanningTree<NodeId, Weight>::update(const NodeId x) {
+    NodeId largest = x;
+    for (int side = 0; side < 2; ++side) {
+        const NodeId c = this->child[side][x];
+        if (c && this->value[this->max_node[c]] > this->value[largest]) {
+            largest = this->max_node[c];
+        }
+    }
+    this->max_node[x] = largest;
+}
+
+template <typename NodeId, typename Weight>
+void DynamicSpanningTree<NodeId, Weight>::rotate(const NodeId x) {
+    const NodeId p = this->parent[x], g = this->parent[p];
+    const int side = (this->child[1][p] == x);
+    if (!this->is_splay_root(p)) {
+        this->child[this->child[1][g] == p][g] = x;
+    }
+    this->parent[x] = g;
+
+    const NodeId moved = this->child[!side][x];
+    this->child[side][p] = moved;
+    if (moved) {
+        this->parent[moved] = p;
+    }
+    this->child[!side][x] = p;
+    this->parent[p] = x;
+    this->update(p);
+    this->update(x);
+}
+
+template <typename NodeId, typename Weight>
+void DynamicSpanningTree<NodeId, Weight>::splay(const NodeId x) {
+    // Pending reversals are pushed from the top of the splay tree down to x first
+    this->splay_path.clear();
+    for (NodeId y = x; ; y = this->parent[y]) {
+        this->splay_path.push_back(y);
+        if (this->is_splay_root(y)) {
+            break;
+        }
+    }
+    for (auto it = this->splay_path.rbegin(); it != this->splay_path.rend(); ++it) {
+        this->push_down(*it);
+    }
+
+    while (!this->is_splay_root(x)) {
+        const NodeId p = this->parent[x], g = this->parent[p];
+        if (!this->is_splay_root(p)) {
+            const bool is_zig_zig = ((this->child[1][g] == p) == (this->child[1][p] == x));
+            this->rotate(is_zig_zig ? p : x);
+        }
+        this->rotate(x);
+    }
+}
+
+template <typename NodeId, typename Weight>
+void DynamicSpanningTree<NodeId, Weight>::access(const NodeId x) {
+    // Makes the path from the root of the represented tree to x preferred
+    NodeId last = 0;
+    for (NodeId y = x; y; y = this->parent[y]) {
+        this->splay(y);
+        this->child[1][y] = last;
+        this->update(y);
+        last = y;
+    }
+    this->splay(x);
+}
+
+template <typename NodeId, typename Weight>
+void DynamicSpanningTree<NodeId, Weight>::make_root(const NodeId x) {
+    this->access(x);
+    this->reversed[x] = !this->reversed[x];
+}
+
+template <typename NodeId, typename Weight>
+NodeId DynamicSpanningTree<NodeId, Weight>::find_root(NodeId x) {
+    this->access(x);
+    while (true) {
+        this->push_down(x);
+        if (!this->child[0][x]) {
+            break;
+        }
+        x = this->child[0][x];
+    }
+    this->splay(x);
+    return x;
+}
+
+template <typename NodeId, typename Weight>
+void DynamicSpanningTree<NodeId, Weight>::link(const NodeId x, const NodeId y) {
+    this->make_root(x);
+    this->parent[x] = y;
+}
+
+template <typename NodeId, typename Weight>
+void DynamicSpanningTree<NodeId, Weight>::cut(const NodeId x, const NodeId y) {
+    // After making x the root and accessing its neighbour y, x is the only node left of y
+    this->make_root(x);
+    this->access(y);
+    this->child[0][y] = 0;
+    this->parent[x] = 0;
+    this->update(y);
+}
+
+template <typename NodeId, typename Weight>
+bool DynamicSpanningTree<NodeId, Weight>::insert_new_edge(const NodeId s, const NodeId d, const Weight w) {
+    if (!is_edge_in_range(s, d, this->num_of_nodes)) {
+        return false;
+    }
+    const NodeId u = this->vertex(s), v = this->vertex(d);
+    if (u == v) {
+        return true;
+    }
+
+    if (this->find_root(u) == this->find_root(v)) {
+        // Edge closes a cycle, it replaces the heaviest edge on the tree path if it is lighter
+        this->make_root(u);
+        this->access(v);
+        const NodeId heaviest = this->max_node[v];
+        if (this->value[heaviest] <= w) {
+            return true;
+        }
+        const Edge<NodeId, Weight> &removed = this->tree_edges[heaviest];
+        this->cut(this->vertex(removed.get_source()), heaviest);
+        this->cut(heaviest, this->vertex(removed.get_destination()));
+        this->mst_cost -= removed.get_weight();
+        this->value[heaviest] = numeric_limits<Weight>::lowest();
+        this->max_node[heaviest] = heaviest;
+        this->free_edge_nodes.push_back(heaviest);
+    }
+
+    const NodeId e = this->free_edge_nodes.back();
+    this->free_edge_nodes.pop_back();
+    this->tree_edges[e] = Edge<NodeId, Weight>(s, d, w);
+    this->value[e] = w;
+    this->max_node[e] = e;
+    this->link(u, e);
+    this->link(e, v);
+    this->mst_cost += w;
+    return true;
+}
+
+template <typename NodeId, typename Weight>
+void DynamicSpanningTree<NodeId, Weight>::export_tree(SpanningTree<NodeId, Weight>& mst) {
+    // Edge nodes not on the free list hold the current tree edges
+    vector<bool> is_free(this->tree_edges.size(), false);
+    for (const NodeId e : this->free_edge_nodes) {
+        is_free[e] = true;
+    }
+    for (size_t e = this->num_of_nodes + 1; e < this->tree_edges.size(); ++e) {
+        if (!is_free[e]) {
+            mst.add_edge(this->tree_edges[e].get_source(), this->tree_edges[e].get_destination(), this->tree_edges[e].get_weight());
+        }
+    }
+}
+
+// Prim pays off when nodes have many neighbours, Kruskal sorts sparse graphs cheaply
+const double PRIM_MIN_DENSITY = 16.0;
+
+// Moves every edge accepted by traverse into the tree, edges must be sorted or heapified before
+template <typename NodeId, typename Weight>
+void add_traversed_edges(PathFinder<NodeId, Weight>& pf, SpanningTree<NodeId, Weight>& mst) {
+    mst.reserve(pf.get_node_size());
+    Edge<NodeId, Weight>* new_edge;
+
+    new_edge = pf.traverse();
+    LOG_TRACE("_____");
+    while (new_edge != nullptr) {
+        mst.add_edge(new_edge->get_source(), new_edge->get_destination(), new_edge->get_weight());
+        new_edge = pf.traverse();
+        LOG_TRACE("_____");
+    }
+}
+
+string choose_engine(const size_t num_of_edges, const size_t num_of_nodes) {
+    const double density = (num_of_nodes > 0) ? double(num_of_edges) / num_of_nodes : 0.0;
+    return (density >= PRIM_MIN_DENSITY) ? "prim" : "kruskal";
+}
+
+template <typename NodeId, typename Weight>
+void build_with_engine(PathFinder<NodeId, Weight>& pf, string engine, SpanningTree<NodeId, Weight>& mst) {
+    if (engine == "auto") {
+        engine = choose_engine(pf.get_edges().size(), pf.get_node_size());
+        LOG_SUMMARY("Selected engine : " << engine);
+    }
+
+    // Engines other than kruskal report their whole build as scan time
+    MstStats* stats = pf.get_stats();
+    STATS(const auto start = chrono::steady_clock::now();)
+    if (engine == "filter") {
+        FilterKruskal<NodeId, Weight> filter_kruskal(pf.get_node_size());
+        filter_kruskal.build(pf.get_edges(), mst);
+    } else if (engine == "boruvka") {
+        Boruvka<NodeId, Weight> boruvka(pf.get_node_size(), pf.get_num_of_threads());
+        boruvka.build(pf.get_edges(), mst);
+    } else if (engine == "prim") {
+        Prim<NodeId, Weight> prim(pf.get_node_size());
+        prim.build(pf.get_edges(), mst);
+    } else if (engine == "lazy") {
+        pf.heapify_edges();
+        STATS(const auto scan_start = chrono::steady_clock::now();)
+        add_traversed_edges(pf, mst);
+        STATS(if (stats) stats->scan_ms += milliseconds_since(scan_start);)
+        return;
+    } else {
+        mst = SpanningTree<NodeId, Weight>(compute_mst(EdgeSpan<NodeId, Weight>(pf.get_edges(), pf.get_node_size()), pf.get_sort_method(), pf.get_num_of_threads(), stats));
+        if (mst.get_edges().size() + 1 >= pf.get_node_size()) {
+            LOG_SUMMARY("Spanning tree now contains " << mst.get_edges().size() << " edges. Terminating...");
+        } else {
+            LOG_SUMMARY("All edges are processed. Terminating...");
+        }
+        return;
+    }
+    STATS(if (stats) {
+        stats->scan_ms += milliseconds_since(start);
+        stats->note_edge_bytes(pf.get_edges().size() * (2 * sizeof(NodeId) + sizeof(Weight)));
+    })
+}
+
+// Reads a batch file holding graphs one after another, each as "num_of_nodes num_of_edges" followed by its (i,j,cost) triples
+// Edges of all the graphs go to one EdgeList and every graph is a span over its own part of it
+template <typename NodeId, typename Weight>
+bool load_batch(const string batch_file, EdgeList<NodeId, Weight>& edges, vector<EdgeSpan<NodeId, Weight>>& graphs) {
+    MappedFile mapped(batch_file);
+    if (!mapped.is_open()) {
+        cerr << "Can not open " << batch_file << endl;
+        return false;
+    }
+
+    const char* cursor = mapped.begin();
+    vector<pair<size_t,size_t>> shapes; // (nodes, edges) of every graph
+    size_t nodes, num_of_edges;
+    while (scan_value(cursor, mapped.end(), nodes) && scan_value(cursor, mapped.end(), num_of_edges)) {
+        NodeId source, destination;
+        Weight weight;
+        for (size_t idx = 0; idx < num_of_edges; ++idx) {
+            if (!(scan_value(cursor, mapped.end(), source) && scan_value(cursor, mapped.end(), destination) && scan_value(cursor, mapped.end(), weight))) {
+                cerr << "Graph " << shapes.size() << " of " << batch_file << " is truncated" << endl;
+                return false;
+            }
+            if (!is_edge_in_range(source, destination, nodes)) {
+                cerr << "Graph " << shapes.size() << " of " << batch_file << " is rejected" << endl;
+                return false;
+            }
+            edges.push_back(source, destination, weight);
+        }
+        shapes.push_back(make_pair(nodes, num_of_edges));
+    }
+
+    // Spans are taken once the arrays are complete and will not move any more
+    size_t first = 0;
+    for (auto &shape : shapes) {
+        graphs.push_back(EdgeSpan<NodeId, Weight>(edges.sources.data() + first, edges.destinations.data() + first, edges.weights.data() + first, shape.second, shape.first));
+        first += shape.second;
+    }
+    return true;
+}
+
+// Weights of generated graphs are drawn from [1, BENCH_MAX_WEIGHT]
+const uint64_t BENCH_MAX_WEIGHT = 1000000;
+
+// splitmix64 sequence, the same seed gives the same graph on every platform
+uint64_t next_random(uint64_t& state) {
+    state += 0x9e3779b97f4a7c15ull;
+    return mix_hash(state);
+}
+
+// Writes a synthetic graph in the text input format, so that the benchmark times parsing as well
+//   sparse   : random spanning tree plus random edges up to num_of_edges
+//   dense    : every pair of nodes joined with probability num_of_edges / (V(V-1)/2), all pairs by default
+//   grid     : square lattice of about num_of_nodes nodes, each joined to its right and lower neighbour
+//   powerlaw : preferential attachment, every new node joins num_of_edges / num_of_nodes earlier nodes
+// Weights are drawn from [1, max_weight], a small range gives many equal weights
+// Returns an empty string for an unknown kind
+string generate_graph(const string kind, size_t num_of_nodes, size_t num_of_edges, uint64_t seed, const uint64_t max_weight=BENCH_MAX_WEIGHT) {
+    string text;
+    vector<pair<size_t,size_t>> pairs;
+    if (kind == "sparse") {
+        for (size_t node = 1; node < num_of_nodes; ++node) {
+            pairs.push_back(make_pair(next_random(seed) % node, node));
+        }
+        while (num_of_nodes > 1 && pairs.size() < num_of_edges) {
+            const size_t source = next_random(seed) % num_of_nodes, destination = next_random(seed) % num_of_nodes;
+            if (source != destination) {
+                pairs.push_back(make_pair(source, destination));
+            }
+        }
+    } else if (kind == "dense") {
+        const double num_of_pairs = double(num_of_nodes) * (num_of_nodes - 1) / 2;
+        const double probability = (num_of_edges == 0 || num_of_edges >= num_of_pairs) ? 1.0 : num_of_edges / num_of_pairs;
+        for (size_t source = 0; source < num_of_nodes; ++source) {
+            for (size_t destination = source + 1; destination < num_of_nodes; ++destination) {
+                if (probability >= 1.0 || (next_random(seed) >> 11) * 0x1.0p-53 < probability) {
+                    pairs.push_back(make_pair(source, destination));
+                }
+            }
+        }
+    } else if (kind == "grid") {
+        size_t side = 1;
+        while ((side + 1) * (side + 1) <= num_of_nodes) {
+            ++side;
+        }
+        num_of_nodes = side * side;
+        for (size_t node = 0; node < num_of_nodes; ++node) {
+            if (node % side + 1 < side) {
+                pairs.push_back(make_pair(node, node + 1));
+            }
+            if (node + side < num_of_nodes) {
+                pairs.push_back(make_pair(node, node + side));
+            }
+        }
+    } else if (kind == "powerlaw") {
+        // A node is picked with probability proportional to its degree by picking a random endpoint of an earlier edge
+        const size_t degree = max<size_t>(1, num_of_nodes > 0 ? num_of_edges / num_of_nodes : 1);
+        vector<size_t> endpoints;
+        for (size_t node = 1; node < num_of_nodes; ++node) {
+            for (size_t link = 0; link < min(degree, node); ++link) {
+                const size_t target = endpoints.empty() ? 0 : endpoints[next_random(seed) % endpoints.size()];
+                pairs.push_back(make_pair(target, node));
+            }
+            for (size_t link = pairs.size() - min(degree, node); link < pairs.size(); ++link) {
+                endpoints.push_back(pairs[link].first);
+                endpoints.push_back(pairs[link].second);
+            }
+        }
+    } else {
+        return text;
+    }
+
+    text.reserve(24 * pairs.size() + 16);
+    text += to_string(num_of_nodes) + "\n";
+    for (auto &edge : pairs) {
+        text += to_string(edge.first) + " " + to_string(edge.second) + " " + to_string(1 + next_random(seed) % max_weight) + "\n";
+    }
+    return text;
+}
+
+// Command line settings, shared by every instantiation of run
+struct Options{
+    string input_file = INPUT_FILE, binary_file, engine = "kruskal", updates_file, batch_file, matrix_file, points_file, tree_file;
+    string weight_type; // int32, or double for points, unless --weights is given
+    unsigned num_of_batch_rounds = 1;
+    string bench_graph; // kind of generated graph, empty unless benchmarking
+    size_t bench_nodes = 100000, bench_edges = 0;
+    uint64_t bench_seed = 1;
+    size_t num_of_verify_graphs = 0; // generated graphs of every kind checked by --verify, 0 unless verifying
+    string temp_directory = getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp";
+    string cache_directory; // trees are cached there by input content when it is given
+    size_t memory_budget = DEFAULT_MEMORY_BUDGET;
+    unsigned num_of_threads = thread::hardware_concurrency();
+    int sort_method = SORT_AUTO;
+    int dedup_policy = DEDUP_EXACT;
+    bool is_forest = false;
+    bool is_stats = false;
+    bool is_numa = false;
+};
+
+template <typename NodeId, typename Weight>
+int run_batch(const Options& options) {
+    EdgeList<NodeId, Weight> edges;
+    vector<EdgeSpan<NodeId, Weight>> graphs;
+    if (!load_batch(options.batch_file, edges, graphs)) {
+        return 1;
+    }
+
+    // Rounds after the first one reuse the buffers of the previous round, as a long running service would
+    MstBatch<NodeId, Weight> batch(options.num_of_threads);
+    const auto start = chrono::steady_clock::now();
+    for (unsigned round = 0; round < options.num_of_batch_rounds; ++round) {
+        batch.build(graphs);
+    }
+    const double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    {
+        TextWriter writer(cout);
+        for (size_t graph = 0; graph < batch.size(); ++graph) {
+            writer << "Graph " << graph << " : " << batch.get_tree_size(graph) << " edges, Cost : " << batch.get_cost(graph) << '\n';
+        }
+    }
+    const double num_of_built_graphs = double(graphs.size()) * options.num_of_batch_rounds;
+    cout << "Computed " << num_of_built_graphs << " spanning trees in " << seconds << " s, "
+        << (seconds > 0 ? num_of_built_graphs / seconds : 0.0) << " graphs/s" << endl;
+    return 0;
+}
+
+// Times every in-memory engine on a generated graph, phases are reported separately
+//   parse : text to edge list, order : sorting or heapifying edges, scan : building the tree from them
+// Engines without a separate ordering phase report all their work as scan, the best of --rounds runs is kept
+template <typename NodeId, typename Weight>
+int run_bench(const Options& options) {
+    const size_t num_of_edges = (options.bench_edges > 0 || options.bench_graph == "dense") ? options.bench_edges : 8 * options.bench_nodes;
+    const string text = generate_graph(options.bench_graph, options.bench_nodes, num_of_edges, options.bench_seed);
+    if (text.empty()) {
+        cerr << "Unknown graph kind " << options.bench_graph << ", expected sparse, dense, grid or powerlaw" << endl;
+        return 1;
+    }
+
+    for (const string engine : {"kruskal", "lazy", "filter", "prim", "boruvka"}) {
+        double best_times[3] = {0, 0, 0}; // parse, order, scan
+        Cost<Weight> cost = 0;
+        size_t nodes = 0, edges = 0;
+        for (unsigned round = 0; round < options.num_of_batch_rounds; ++round) {
+            PathFinder<NodeId, Weight> pf;
+            pf.set_num_of_threads(options.num_of_threads);
+            pf.set_sort_method(options.sort_method);
+            pf.set_dedup_policy(options.dedup_policy);
+            SpanningTree<NodeId, Weight> mst;
+            double times[3];
+
+            auto start = chrono::steady_clock::now();
+            pf.parse_input_buffer(text.data(), text.data() + text.size());
+            times[0] = milliseconds_since(start);
+
+            if (engine == "lazy") {
+                start = chrono::steady_clock::now();
+                pf.heapify_edges();
+                times[1] = milliseconds_since(start);
+                start = chrono::steady_clock::now();
+                add_traversed_edges(pf, mst);
+                times[2] = milliseconds_since(start);
+            } else {
+                // Kruskal runs through compute_mst as outside of the benchmark, its sort phase comes from the statistics
+                // and the rest of the build counts as scan, all of it without statistics compiled in
+                MstStats stats;
+                pf.set_stats(&stats);
+                start = chrono::steady_clock::now();
+                build_with_engine(pf, engine, mst);
+                const double build_ms = milliseconds_since(start);
+                times[1] = stats.sort_ms;
+                times[2] = build_ms - stats.sort_ms;
+            }
+
+            for (int phase = 0; phase < 3; ++phase) {
+                best_times[phase] = (round == 0) ? times[phase] : min(best_times[phase], times[phase]);
+            }
+            cost = mst.get_cost();
+            nodes = pf.get_node_size();
+            edges = pf.get_edges().size();
+        }
+        cout << "Engine " << engine << " : " << nodes << " nodes, " << edges << " edges, parse " << best_times[0] << " ms, order "
+            << best_times[1] << " ms, scan " << best_times[2] << " ms, total " << best_times[0] + best_times[1] + best_times[2]
+            << " ms, Cost : " << cost << endl;
+    }
+    return 0;
+}
+
+// Minimum spanning forest of edges computed apart from every engine, the oracle of --verify
+// A plain comparison sort and its own union-find with path halving only, so that a bug in the shared kernels can not hide itself
+template <typename NodeId, typename Weight>
+Cost<Weight> reference_forest_cost(const EdgeList<NodeId, Weight>& edges, const size_t num_of_nodes, size_t& num_of_forest_edges) {
+    vector<size_t> order(edges.size()), parents(num_of_nodes);
+    for (size_t idx = 0; idx < order.size(); ++idx) {
+        order[idx] = idx;
+    }
+    for (size_t node = 0; node < num_of_nodes; ++node) {
+        parents[node] = node;
+    }
+    stable_sort(order.begin(), order.end(), [&](const size_t a, const size_t b) {return edges.weights[a] < edges.weights[b];});
+
+    auto find = [&](size_t node) {
+        while (parents[node] != node) {
+            parents[node] = parents[parents[node]];
+            node = parents[node];
+        }
+        return node;
+    };
+    Cost<Weight> cost = 0;
+    num_of_forest_edges = 0;
+    for (const size_t position : order) {
+        const size_t a = find(edges.sources[position]), b = find(edges.destinations[position]);
+        if (a != b) {
+            parents[a] = b;
+            cost += edges.weights[position];
+            num_of_forest_edges ++;
+        }
+    }
+    return cost;
+}
+
+// Floating point costs are summed in a different order by every engine, so they only have to agree closely
+template <typename Weight>
+bool is_same_cost(const Cost<Weight> a, const Cost<Weight> b) {
+    if (is_integral<Weight>::value) {
+        return a == b;
+    }
+    return abs(double(a) - double(b)) <= 1e-9 * max(1.0, abs(double(b)));
+}
+
+// Checks that tree is a minimum spanning forest of edges : every tree edge is an input edge, none of them closes a cycle,
+// there are as many of them as in the reference forest and their weights add up to both the reported and the reference cost
+// Returns an empty string for a valid tree, otherwise the first problem found
+template <typename NodeId, typename Weight>
+string check_spanning_forest(const EdgeList<NodeId, Weight>& edges, const size_t num_of_nodes, const vector<Edge<NodeId, Weight>>& tree,
+                             const Cost<Weight> reported_cost, const Cost<Weight> reference_cost, const size_t reference_size) {
+    vector<tuple<NodeId, NodeId, Weight>> input(edges.size());
+    for (size_t idx = 0; idx < edges.size(); ++idx) {
+        input[idx] = make_tuple(min(edges.sources[idx], edges.destinations[idx]), max(edges.sources[idx], edges.destinations[idx]), edges.weights[idx]);
+    }
+    sort(input.begin(), input.end());
+
+    DisjointSet<NodeId> forest(num_of_nodes);
+    Cost<Weight> cost = 0;
+    for (auto &edge : tree) {
+        const NodeId source = edge.get_source(), destination = edge.get_destination();
+        if (source >= num_of_nodes || destination >= num_of_nodes ||
+            !binary_search(input.begin(), input.end(), make_tuple(min(source, destination), max(source, destination), edge.get_weight()))) {
+            return "edge (" + to_string(source) + "," + to_string(destination) + ") is not in the graph";
+        }
+        if (!forest.unite(source, destination)) {
+            return "edge (" + to_string(source) + "," + to_string(destination) + ") closes a cycle";
+        }
+        cost += edge.get_weight();
+    }
+    if (tree.size() != reference_size) {
+        return to_string(tree.size()) + " edges instead of " + to_string(reference_size);
+    }
+    if (!is_same_cost<Weight>(cost, reported_cost)) {
+        return "reported cost " + to_string(reported_cost) + " but its edges add up to " + to_string(cost);
+    }
+    if (!is_same_cost<Weight>(cost, reference_cost)) {
+        return "cost " + to_string(cost) + " instead of " + to_string(reference_cost);
+    }
+    return "";
+}
+
+// Upper bound of the node count of the graphs generated by --verify, small enough to check hundreds of them per second
+const size_t VERIFY_MAX_NODES = 2000;
+// Node count and worker count of the two large graphs checked after the others
+const size_t VERIFY_LARGE_NODES = 20000;
+const unsigned VERIFY_LARGE_WORKERS = 4;
+
+// Differential test of every engine against reference_forest_cost on generated graphs
+// Graph sizes, densities and weight ranges are drawn from --seed, a narrow weight range gives many ties
+// and extra isolated nodes make some graphs disconnected. Returns 1 when any engine disagrees
+template <typename NodeId, typename Weight>
+int run_verify(const Options& options) {
+    const vector<string> engines = {"kruskal", "lazy", "filter", "prim", "boruvka", "external", "batch", "dynamic", "dense"};
+    uint64_t state = options.bench_seed;
+    size_t num_of_checks = 0, num_of_failures = 0;
+
+    // Every engine against the reference on one graph, workers and sort_method go to the engines taking them
+    auto check_graph = [&](const string kind, const string& text, const uint64_t seed, const uint64_t max_weight, const unsigned workers, const int sort_method) {
+        PathFinder<NodeId, Weight> reference;
+        reference.set_dedup_policy(options.dedup_policy);
+        reference.parse_input_buffer(text.data(), text.data() + text.size());
+        const size_t num_of_nodes = reference.get_node_size();
+        size_t reference_size;
+        const Cost<Weight> reference_cost = reference_forest_cost(reference.get_edges(), num_of_nodes, reference_size);
+
+        for (auto &engine : engines) {
+            SpanningTree<NodeId, Weight> mst;
+            if (engine == "dense") {
+                // Lightest edge of every pair, graphs with a missing pair are skipped
+                const EdgeList<NodeId, Weight> &input = reference.get_edges();
+                if (input.size() < num_of_nodes * (num_of_nodes - 1) / 2) {
+                    continue; // too few edges to join every pair, no need for the matrix
+                }
+                vector<Weight> matrix(num_of_nodes * num_of_nodes);
+                vector<bool> is_joined(num_of_nodes * num_of_nodes, false);
+                size_t num_of_pairs = 0;
+                for (size_t idx = 0; idx < input.size(); ++idx) {
+                    if (input.sources[idx] == input.destinations[idx]) {
+                        continue;
+                    }
+                    for (const size_t cell : {input.sources[idx] * num_of_nodes + input.destinations[idx], input.destinations[idx] * num_of_nodes + input.sources[idx]}) {
+                        num_of_pairs += !is_joined[cell];
+                        matrix[cell] = is_joined[cell] ? min(matrix[cell], input.weights[idx]) : input.weights[idx];
+                        is_joined[cell] = true;
+                    }
+                }
+                if (num_of_pairs < num_of_nodes * (num_of_nodes - 1)) {
+                    continue;
+                }
+                MstResult<NodeId, Weight> result;
+                compute_dense_mst(num_of_nodes, [&](const NodeId node, const NodeId* targets, const size_t count, Weight* weights) {
+                    for (size_t idx = 0; idx < count; ++idx) {
+                        weights[idx] = matrix[node * num_of_nodes + targets[idx]];
+                    }
+                }, result);
+                mst = SpanningTree<NodeId, Weight>(move(result));
+            } else if (engine == "external") {
+                // A budget of a few kilobytes sends the larger graphs through several sorted runs on disk, a few dozen at most
+                string path = options.temp_directory + "/mst_verify_XXXXXX";
+                const int file = mkstemp(&path[0]);
+                const bool is_written = file >= 0 && write(file, text.data(), text.size()) == ssize_t(text.size());
+                if (file >= 0) {
+                    close(file);
+                }
+                ExternalKruskal<NodeId, Weight> external_kruskal(max<size_t>(16 << 10, text.size() / 16), options.temp_directory);
+                if (!is_written || !external_kruskal.build(path, mst)) {
+                    cerr << "Can not run the external engine in " << options.temp_directory << endl;
+                }
+                unlink(path.c_str());
+            } else if (engine == "batch") {
+                MstBatch<NodeId, Weight> batch(workers);
+                batch.build(vector<EdgeSpan<NodeId, Weight>>(1, EdgeSpan<NodeId, Weight>(reference.get_edges(), num_of_nodes)));
+                for (size_t idx = 0; idx < batch.get_tree_size(0); ++idx) {
+                    const Edge<NodeId, Weight> &edge = batch.get_tree(0)[idx];
+                    mst.add_edge(edge.get_source(), edge.get_destination(), edge.get_weight());
+                }
+            } else if (engine == "dynamic") {
+                // Edges arrive in input order, so most insertions replace a heavier tree edge
+                DynamicSpanningTree<NodeId, Weight> dynamic_mst(num_of_nodes);
+                const EdgeList<NodeId, Weight> &input = reference.get_edges();
+                for (size_t idx = 0; idx < input.size(); ++idx) {
+                    dynamic_mst.insert_new_edge(input.sources[idx], input.destinations[idx], input.weights[idx]);
+                }
+                dynamic_mst.export_tree(mst);
+            } else {
+                PathFinder<NodeId, Weight> pf;
+                pf.set_num_of_threads(workers);
+                pf.set_sort_method(sort_method);
+                pf.set_dedup_policy(options.dedup_policy);
+                pf.parse_input_buffer(text.data(), text.data() + text.size());
+                build_with_engine(pf, engine, mst);
+            }
+
+            const string problem = check_spanning_forest(reference.get_edges(), num_of_nodes, mst.get_edges(), mst.get_cost(), reference_cost, reference_size);
+            num_of_checks ++;
+            if (!problem.empty()) {
+                num_of_failures ++;
+                cout << "Engine " << engine << " failed on a " << kind << " graph of " << num_of_nodes << " nodes and "
+                    << reference.get_edges().size() << " edges (seed " << seed << ", weights up to " << max_weight << ") : " << problem << endl;
+            }
+        }
+    };
+
+    for (size_t round = 0; round < options.num_of_verify_graphs; ++round) {
+        for (const string kind : {"sparse", "dense", "grid", "powerlaw"}) {
+            const size_t nodes = 1 + next_random(state) % ((kind == "dense") ? VERIFY_MAX_NODES / 8 : VERIFY_MAX_NODES);
+            // Dense graphs are complete every fourth time or so, the dense engine only runs on those
+            const size_t edges = (kind == "dense") ? nodes * (next_random(state) % nodes) / 2 : nodes * (next_random(state) % 9);
+            const uint64_t seed = next_random(state), max_weight = (next_random(state) % 2) ? 16 : BENCH_MAX_WEIGHT;
+            string text = generate_graph(kind, nodes, edges, seed, max_weight);
+            if (next_random(state) % 3 == 0) {
+                // Declare more nodes than the edges reach
+                const size_t header_end = text.find('\n');
+                text.replace(0, header_end, to_string(stoull(text.substr(0, header_end)) + 1 + next_random(state) % 8));
+            }
+            if (next_random(state) % 3 == 0) {
+                // A lightest self-loop on every node, the generators never produce them and no engine may pick one
+                const size_t declared = stoull(text.substr(0, text.find('\n')));
+                for (size_t node = 0; node < declared; ++node) {
+                    text += to_string(node) + " " + to_string(node) + " 0\n";
+                }
+            }
+
+            check_graph(kind, text, seed, max_weight, options.num_of_threads, options.sort_method);
+        }
+
+        if constexpr (is_floating_point<Weight>::value) {
+            // Euclidean engine against the complete graph of the points, small integer coordinates repeat points and distances
+            PointSet points;
+            points.num_of_points = 1 + next_random(state) % (VERIFY_MAX_NODES / 8);
+            points.dimensions = 1 + next_random(state) % 4;
+            const uint64_t range = (next_random(state) % 2) ? 8 : BENCH_MAX_WEIGHT;
+            points.coordinates.resize(points.num_of_points * points.dimensions);
+            for (auto &coordinate : points.coordinates) {
+                coordinate = double(next_random(state) % range) / 4;
+            }
+            EdgeList<NodeId, Weight> pairs;
+            for (size_t a = 0; a < points.num_of_points; ++a) {
+                for (size_t b = a + 1; b < points.num_of_points; ++b) {
+                    const double distance = squared_distance(&points.coordinates[a * points.dimensions], &points.coordinates[b * points.dimensions], points.dimensions);
+                    pairs.push_back(NodeId(a), NodeId(b), Weight(sqrt(distance)));
+                }
+            }
+            size_t reference_size;
+            const Cost<Weight> reference_cost = reference_forest_cost(pairs, points.num_of_points, reference_size);
+            SpanningTree<NodeId, Weight> mst;
+            EuclideanBoruvka<NodeId, Weight> euclidean_boruvka;
+            euclidean_boruvka.build(points, mst);
+            const string problem = check_spanning_forest(pairs, points.num_of_points, mst.get_edges(), mst.get_cost(), reference_cost, reference_size);
+            num_of_checks ++;
+            if (!problem.empty()) {
+                num_of_failures ++;
+                cout << "Engine euclidean failed on " << points.num_of_points << " points in " << points.dimensions << " dimensions : " << problem << endl;
+            }
+
+            // NaN weights have no minimum, the vector searches of dense Prim must still pick the key the scalar loop picks
+            // and the dense engine must still give a spanning tree of the complete graph
+            const size_t num_of_keys = 1 + next_random(state) % 200;
+            vector<Weight> matrix(num_of_keys * num_of_keys);
+            for (auto &weight : matrix) {
+                weight = (next_random(state) % 4 == 0) ? numeric_limits<Weight>::quiet_NaN() : Weight(next_random(state) % 16);
+            }
+            for (size_t first = 0; first < num_of_keys; ++first) {
+                const size_t expected = first + min_key_position_scalar(&matrix[first * num_of_keys + first], num_of_keys - first);
+                const size_t position = first + min_key_position(&matrix[first * num_of_keys + first], num_of_keys - first);
+                num_of_checks ++;
+                if (position != expected) {
+                    num_of_failures ++;
+                    cout << "Key search failed on " << num_of_keys - first << " keys with NaN : position " << position << " instead of " << expected << endl;
+                }
+            }
+            MstResult<NodeId, Weight> result;
+            compute_dense_mst(num_of_keys, [&](const NodeId node, const NodeId* targets, const size_t count, Weight* weights) {
+                for (size_t idx = 0; idx < count; ++idx) {
+                    weights[idx] = matrix[min<size_t>(node, targets[idx]) * num_of_keys + max<size_t>(node, targets[idx])];
+                }
+            }, result);
+            DisjointSet<NodeId> forest;
+            forest.reset(num_of_keys);
+            bool is_tree = result.edges.size() + 1 == num_of_keys;
+            for (auto &edge : result.edges) {
+                is_tree = is_tree && edge.get_source() < num_of_keys && edge.get_destination() < num_of_keys && forest.unite(edge.get_source(), edge.get_destination());
+            }
+            num_of_checks ++;
+            if (!is_tree) {
+                num_of_failures ++;
+                cout << "Engine dense failed on a complete graph of " << num_of_keys << " nodes with NaN weights : no spanning tree" << endl;
+            }
+        }
+    }
+
+    // Graphs above MIN_PARALLEL_PARSE_BYTES, PARALLEL_SORT_MIN_ITEMS, KRUSKAL_FILTER_BLOCK_EDGES and BORUVKA_TASK_EDGES,
+    // checked with several workers even on a single core. The comparison sort takes the parallel merge sort for integral weights too
+    if (options.num_of_verify_graphs > 0) {
+        const unsigned workers = max(options.num_of_threads, VERIFY_LARGE_WORKERS);
+        for (const int sort_method : {SORT_COMPARISON, options.sort_method}) {
+            const uint64_t seed = next_random(state), max_weight = (sort_method == SORT_COMPARISON) ? 16 : BENCH_MAX_WEIGHT;
+            check_graph("sparse", generate_graph("sparse", VERIFY_LARGE_NODES, 20 * VERIFY_LARGE_NODES, seed, max_weight), seed, max_weight, workers, sort_method);
+        }
+    }
+    cout << "Verified " << num_of_checks << " trees, " << num_of_failures << " failures" << endl;
+    return (num_of_failures > 0) ? 1 : 0;
+}
+
+// Bump whenever an engine may build a different tree, or a differently ordered one, from the same input
+// Cached trees of other versions are then never looked up again
+const uint64_t MST_ENGINE_VERSION = 1;
+
+// Cache entry of the input of a run, named after the hash of the input bytes and of every setting shaping the tree
+// Returns an empty string when the input can not be mapped, pipes are never cached
+template <typename NodeId, typename Weight>
+string cache_path(const Options& options) {
+    const string mode = !options.points_file.empty() ? "points" : (!options.matrix_file.empty() ? "matrix" : "edges");
+    const string input_file = !options.points_file.empty() ? options.points_file : (!options.matrix_file.empty() ? options.matrix_file : options.input_file);
+    MappedFile mapped(input_file);
+    if (!mapped.is_open()) {
+        return "";
+    }
+    const string settings = mode + " " + options.engine + " " + options.weight_type + " " + to_string(sizeof(NodeId)) + " " + to_string(options.dedup_policy);
+    const uint64_t key = hash_bytes(settings.data(), settings.size(), hash_bytes(mapped.begin(), mapped.size(), MST_ENGINE_VERSION));
+    char name[17];
+    snprintf(name, sizeof(name), "%016llx", (unsigned long long)key);
+    return options.cache_directory + "/" + name + ".mst";
+}
+
+// Creates path and its missing parents like mkdir -p, true when path is a directory afterwards
+bool make_directories(const string path) {
+    for (size_t slash = path.find('/', 1); ; slash = path.find('/', slash + 1)) {
+        const string prefix = path.substr(0, slash);
+        if (mkdir(prefix.c_str(), 0755) != 0 && errno != EEXIST) {
+            return false;
+        }
+        if (slash == string::npos) {
+            break;
+        }
+    }
+    struct stat info;
+    return stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+}
+
+template <typename NodeId, typename Weight>
+int run(const Options& options) {
+    if (!options.batch_file.empty()) {
+        return run_batch<NodeId, Weight>(options);
+    }
+    if (options.num_of_verify_graphs > 0) {
+        return run_verify<NodeId, Weight>(options);
+    }
+    if (!options.bench_graph.empty()) {
+        return run_bench<NodeId, Weight>(options);
+    }
+
+    SpanningTree<NodeId, Weight> mst;
+    MstStats stats;
+    size_t num_of_nodes;
+    // A cached tree replaces the whole build, updates are still applied to it afterwards
+    STATS(const auto cache_start = chrono::steady_clock::now();)
+    const string cache_file = (options.cache_directory.empty() || !options.binary_file.empty()) ? "" : cache_path<NodeId, Weight>(options);
+    const bool is_cached = !cache_file.empty() && mst.read_binary(cache_file, num_of_nodes);
+    if (is_cached) {
+        LOG_SUMMARY("Spanning tree loaded from " << cache_file);
+        STATS(stats.parse_ms = milliseconds_since(cache_start);)
+    } else if (!options.points_file.empty()) {
+        if (is_integral<Weight>::value) {
+            cerr << "Euclidean distances need --weights=float or --weights=double" << endl;
+            return 1;
+        }
+        STATS(const auto start = chrono::steady_clock::now();)
+        PointSet points;
+        if (!load_points(options.points_file, points)) {
+            return 1;
+        }
+        num_of_nodes = points.num_of_points;
+        EuclideanBoruvka<NodeId, Weight> euclidean_boruvka;
+        euclidean_boruvka.build(points, mst);
+        STATS(stats.scan_ms = milliseconds_since(start);)
+    } else if (!options.matrix_file.empty()) {
+        // No edge list at all, so the whole build counts as scan time
+        STATS(const auto start = chrono::steady_clock::now();)
+        DenseMatrix<NodeId, Weight> matrix(options.matrix_file);
+        if (!matrix.is_open()) {
+            return 1;
+        }
+        num_of_nodes = matrix.get_node_size();
+        MstResult<NodeId, Weight> result;
+        compute_dense_mst(num_of_nodes, [&](const NodeId node, const NodeId* targets, const size_t count, Weight* weights) {
+            matrix.read_weights(node, targets, count, weights);
+        }, result);
+        mst = SpanningTree<NodeId, Weight>(move(result));
+        STATS(stats.scan_ms = milliseconds_since(start);)
+    } else if (options.engine == "external") {
+        // Reading, sorting and merging runs overlap, so the whole build counts as scan time
+        STATS(const auto start = chrono::steady_clock::now();)
+        ExternalKruskal<NodeId, Weight> external_kruskal(options.memory_budget, options.temp_directory);
+        if (!external_kruskal.build(options.input_file, mst)) {
+            return 1;
+        }
+        num_of_nodes = external_kruskal.get_node_size();
+        STATS(stats.scan_ms = milliseconds_since(start);)
+    } else {
+        PathFinder<NodeId, Weight> pf;
+        pf.set_num_of_threads(options.num_of_threads);
+        pf.set_sort_method(options.sort_method);
+        pf.set_dedup_policy(options.dedup_policy);
+        pf.set_stats(options.is_stats ? &stats : nullptr);
+        if (!pf.parse_input(options.input_file)) {
+            return 1;
+        }
+        if (!options.binary_file.empty()) {
+            return pf.write_binary(options.binary_file) ? 0 : 1;
+        }
+        num_of_nodes = pf.get_node_size();
+        build_with_engine(pf, options.engine, mst);
+    }
+    if (!cache_file.empty() && !is_cached) {
+        // Written under a temporary name and renamed, so a concurrent run never reads half a tree
+        const string temp_file = cache_file + "." + to_string(getpid());
+        if (make_directories(options.cache_directory) && mst.write_binary(temp_file, num_of_nodes) && rename(temp_file.c_str(), cache_file.c_str()) == 0) {
+            LOG_SUMMARY("Spanning tree cached in " << cache_file);
+        } else {
+            unlink(temp_file.c_str());
+            cerr << "Can not cache the tree in " << options.cache_directory << endl;
+        }
+    }
+
+    if (!options.updates_file.empty()) {
+        // Keep the tree up to date while the new edges arrive, instead of rebuilding it
+        DynamicSpanningTree<NodeId, Weight> dynamic_mst(num_of_nodes);
+        for (auto &edge : mst.get_edges()) {
+            dynamic_mst.insert_new_edge(edge.get_source(), edge.get_destination(), edge.get_weight());
+        }
+        MappedFile updates(options.updates_file);
+        if (!updates.is_open()) {
+            cerr << "Can not open " << options.updates_file << endl;
+            return 1;
+        }
+        const char* cursor = updates.begin();
+        NodeId source, destination;
+        Weight weight;
+        while (scan_value(cursor, updates.end(), source) && scan_value(cursor, updates.end(), destination) && scan_value(cursor, updates.end(), weight)) {
+            if (!dynamic_mst.insert_new_edge(source, destination, weight)) {
+                return 1;
+            }
+        }
+        mst = SpanningTree<NodeId, Weight>();
+        dynamic_mst.export_tree(mst);
+    }
+
+    STATS(const auto output_start = chrono::steady_clock::now();)
+    if (!options.tree_file.empty()) {
+        // Edges go to the binary file, only the cost is printed
+        if (!mst.write_binary(options.tree_file, num_of_nodes)) {
+            return 1;
+        }
+        cout << "Spanning tree of " << mst.get_edges().size() << " edges written to " << options.tree_file << endl;
+        cout << "Cost of the Spanning Tree : " << mst.get_cost() << endl;
+    } else if (options.is_forest) {
+        cout << "Minimum Spanning Forest and its trees: " << endl;
+        mst.print_forest(num_of_nodes);
+    } else {
+        if (num_of_nodes > 0 && mst.get_edges().size() < num_of_nodes - 1) {
+            LOG_SUMMARY("Graph is disconnected, " << mst.get_edges().size() << " edges found instead of " << num_of_nodes - 1
+                << ". Use --forest for the trees of every component");
+        }
+        cout << "Minimum Spanning Tree and its components: " << endl;
+        mst.print();
+    }
+    STATS(if (options.is_stats) {
+        stats.output_ms = milliseconds_since(output_start);
+        stats.print_json(cout);
+    })
+
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    // Input file can be given as an argument, defaults to mst_data.in
+    // --threads=N sets the number of parsing and sorting threads
+    // --sort=radix|comparison forces a sort method, comparison sort is parallel
+    // --dedup=exact|min|none drops repeated (i,j,cost) edges in any direction, keeps only the lightest of parallel edges or keeps all
+    // --engine=kruskal|filter|lazy|prim|boruvka|external|auto selects the algorithm
+    //     filter runs Filter-Kruskal, lazy pops edges from a heap instead of sorting all of them
+    //     boruvka runs on --threads workers, auto picks prim or kruskal by the density of the graph
+    //     external streams the input through sorted runs on disk, see --memory and --temp-dir
+    // --memory=MB bounds the edge buffers of the external engine, 1024 by default
+    // --cache-dir=DIR reuses the tree stored for an input with the same content and settings, or stores it there
+    // --temp-dir=DIR keeps the sorted runs of the external engine, TMPDIR or /tmp by default
+    // --weights=int32|int64|float|double selects the weight type, node ids are 32-bit unsigned, int32 by default and double for --points
+    // --convert=FILE writes the parsed graph in binary format and exits
+    // --points=FILE builds the Euclidean tree of the points of FILE, "num_of_points dimensions" and then their coordinates
+    // --matrix=FILE builds the tree of the complete graph given as a weight matrix, one row per line, with O(V^2) Prim
+    // --updates=FILE inserts the (i,j,cost) triples of FILE into the built tree one by one
+    // --tree=FILE writes the tree edges to FILE in the binary edge-list format instead of printing them
+    // --numa pins the workers node by node, keeps their tasks on the edges of their node and places arrays by first touch
+    // --forest reports every tree of a disconnected graph along with its own cost
+    // --stats prints phase times, edge and union-find counters and peak edge memory as JSON after the tree
+    // --batch=FILE computes the trees of all the graphs of FILE on --threads workers and reports graphs per second
+    // --rounds=N builds the batch N times, reusing the buffers of the previous rounds
+    // --bench=sparse|dense|grid|powerlaw times every engine phase by phase on a generated graph, best of --rounds
+    //     --nodes=N and --edges=M size the graph, --seed=S selects it
+    // --verify=N checks every engine against a reference forest on N generated graphs of each kind, 100 by default
+    Options options;
+    for (int idx = 1; idx < argc; ++idx) {
+        const string arg = argv[idx];
+        if (arg.rfind("--threads=", 0) == 0) {
+            options.num_of_threads = stoi(arg.substr(10));
+        } else if (arg == "--sort=radix") {
+            options.sort_method = SORT_RADIX;
+        } else if (arg == "--sort=comparison") {
+            options.sort_method = SORT_COMPARISON;
+        } else if (arg == "--dedup=exact") {
+            options.dedup_policy = DEDUP_EXACT;
+        } else if (arg == "--dedup=min") {
+            options.dedup_policy = DEDUP_MIN_WEIGHT;
+        } else if (arg == "--dedup=none") {
+            options.dedup_policy = DEDUP_NONE;
+        } else if (arg.rfind("--engine=", 0) == 0) {
+            options.engine = arg.substr(9);
+        } else if (arg.rfind("--memory=", 0) == 0) {
+            options.memory_budget = stoull(arg.substr(9)) << 20;
+        } else if (arg.rfind("--cache-dir=", 0) == 0) {
+            options.cache_directory = arg.substr(12);
+        } else if (arg.rfind("--temp-dir=", 0) == 0) {
+            options.temp_directory = arg.substr(11);
+        } else if (arg.rfind("--weights=", 0) == 0) {
+            options.weight_type = arg.substr(10);
+        } else if (arg.rfind("--points=", 0) == 0) {
+            options.points_file = arg.substr(9);
+        } else if (arg.rfind("--matrix=", 0) == 0) {
+            options.matrix_file = arg.substr(9);
+        } else if (arg.rfind("--batch=", 0) == 0) {
+            options.batch_file = arg.substr(8);
+        } else if (arg.rfind("--bench=", 0) == 0) {
+            options.bench_graph = arg.substr(8);
+        } else if (arg.rfind("--nodes=", 0) == 0) {
+            options.bench_nodes = stoull(arg.substr(8));
+        } else if (arg.rfind("--edges=", 0) == 0) {
+            options.bench_edges = stoull(arg.substr(8));
+        } else if (arg.rfind("--seed=", 0) == 0) {
+            options.bench_seed = stoull(arg.substr(7));
+        } else if (arg == "--verify") {
+            options.num_of_verify_graphs = 100;
+        } else if (arg.rfind("--verify=", 0) == 0) {
+            options.num_of_verify_graphs = stoull(arg.substr(9));
+        } else if (arg.rfind("--rounds=", 0) == 0) {
+            options.num_of_batch_rounds = max(1, stoi(arg.substr(9)));
+        } else if (arg == "--stats") {
+            options.is_stats = true;
+#ifdef MST_NO_STATS
+            cerr << "Statistics are compiled out by MST_NO_STATS" << endl;
+#endif
+        } else if (arg.rfind("--tree=", 0) == 0) {
+            options.tree_file = arg.substr(7);
+        } else if (arg == "--numa") {
+            options.is_numa = true;
+        } else if (arg == "--forest") {
+            options.is_forest = true;
+        } else if (arg.rfind("--updates=", 0) == 0) {
+            options.updates_file = arg.substr(10);
+        } else if (arg.rfind("--convert=", 0) == 0) {
+            options.binary_file = arg.substr(10);
+        } else {
+            options.input_file = arg;
+        }
+    }
+
+    // A misspelled engine would silently run kruskal and still be part of the cache key
+    const string engines[] = {"kruskal", "filter", "lazy", "prim", "boruvka", "external", "auto"};
+    if (find(begin(engines), end(engines), options.engine) == end(engines)) {
+        cerr << "Unknown engine " << options.engine << ", expected kruskal, filter, lazy, prim, boruvka, external or auto" << endl;
+        return 1;
+    }
+    if (options.is_numa) {
+        enable_numa_placement();
+    }
+    if (options.weight_type.empty()) {
+        options.weight_type = options.points_file.empty() ? "int32" : "double";
+    }
+    if (options.weight_type == "int32") {
+        return run<uint32_t, int32_t>(options);
+    } else if (options.weight_type == "int64") {
+        return run<uint32_t, int64_t>(options);
+    } else if (options.weight_type == "float") {
+        return run<uint32_t, float>(options);
+    } else if (options.weight_type == "double") {
+        return run<uint32_t, double>(options);
+    }
+    cerr << "Unknown weight type " << options.weight_type << endl;
+    return 1;
+}